@@ -0,0 +1,211 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Measures AAF decompression throughput for different worker counts.
+// Usage: AAFBench [file.ee] [-size MB] [-chunk MB] [-runs N] [-threads MAX]
+// Without input file, a synthetic mesh-like payload is compressed first.
+
+#include "AAFDecompress.h"
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+static std::vector<char> BuildPayload(size_t size)
+{
+	std::vector<char> payload(size);
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+
+	float *floats = reinterpret_cast<float *>(payload.data());
+	const size_t numFloats = size / sizeof(float);
+
+	for (size_t f = 0; f < numFloats; f++)
+		floats[f] = std::sin(static_cast<float>(f % 4096) * 0.01f) + ((f & 7) ? 0.f : noise(rng));
+
+	return payload;
+}
+
+static std::vector<char> CompressAAF(const std::vector<char> &payload, size_t chunkSize)
+{
+	std::vector<char> output(sizeof(AAFHeader));
+	const size_t numChunks = (payload.size() + chunkSize - 1) / chunkSize;
+
+	AAFHeader hdr = {};
+	hdr.magic = AAFHeader::ID;
+	hdr.version = 1;
+	memcpy(hdr.comment, "AVALANCHEARCHIVEFORMATISCOOL", sizeof(hdr.comment));
+	hdr.uncompressedSize = static_cast<uint32_t>(payload.size());
+	hdr.maxChunkSize = static_cast<uint32_t>(chunkSize);
+	hdr.numChunks = static_cast<uint32_t>(numChunks);
+	memcpy(output.data(), &hdr, sizeof(hdr));
+
+	std::vector<char> compressed(compressBound(static_cast<uLong>(chunkSize)));
+
+	for (size_t c = 0; c < numChunks; c++)
+	{
+		const size_t offset = c * chunkSize;
+		const size_t curSize = payload.size() - offset < chunkSize ? payload.size() - offset : chunkSize;
+
+		z_stream stream = {};
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(payload.data() + offset));
+		stream.avail_in = static_cast<uInt>(curSize);
+		stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+		stream.avail_out = static_cast<uInt>(compressed.size());
+		deflate(&stream, Z_FINISH);
+
+		const uint32_t compressedSize = static_cast<uint32_t>(stream.total_out);
+		deflateEnd(&stream);
+
+		AAFChunkHeader chunkHdr;
+		chunkHdr.compressedSize = compressedSize;
+		chunkHdr.uncompressedSize = static_cast<uint32_t>(curSize);
+		chunkHdr.chunkSize = (sizeof(AAFChunkHeader) + compressedSize + 15) & ~15;
+		chunkHdr.magic = AAFHeader::CHUNK_ID;
+
+		const size_t chunkBegin = output.size();
+		output.resize(chunkBegin + chunkHdr.chunkSize);
+		memcpy(output.data() + chunkBegin, &chunkHdr, sizeof(chunkHdr));
+		memcpy(output.data() + chunkBegin + sizeof(chunkHdr), compressed.data(), compressedSize);
+	}
+
+	return output;
+}
+
+static std::vector<char> ReadFile(const char *fileName)
+{
+	std::vector<char> data;
+	FILE *fle = fopen(fileName, "rb");
+
+	if (!fle)
+		return data;
+
+	fseek(fle, 0, SEEK_END);
+	data.resize(ftell(fle));
+	fseek(fle, 0, SEEK_SET);
+
+	if (fread(data.data(), 1, data.size(), fle) != data.size())
+		data.clear();
+
+	fclose(fle);
+
+	return data;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *inputFile = nullptr;
+	size_t payloadSize = 256;
+	size_t chunkSize = 32;
+	int numRuns = 5;
+	int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-size") && a + 1 < argc)
+			payloadSize = strtoul(argv[++a], nullptr, 10);
+		else if (!strcmp(argv[a], "-chunk") && a + 1 < argc)
+			chunkSize = strtoul(argv[++a], nullptr, 10);
+		else if (!strcmp(argv[a], "-runs") && a + 1 < argc)
+			numRuns = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-threads") && a + 1 < argc)
+			maxThreads = atoi(argv[++a]);
+		else
+			inputFile = argv[a];
+	}
+
+	std::vector<char> aaf;
+	std::vector<char> payload;
+
+	if (inputFile)
+	{
+		aaf = ReadFile(inputFile);
+
+		if (!IsAAF(aaf.data(), aaf.size()))
+		{
+			printf("%s is not an AAF file.\n", inputFile);
+			return 1;
+		}
+	}
+	else
+	{
+		payload = BuildPayload(payloadSize << 20);
+		aaf = CompressAAF(payload, chunkSize << 20);
+	}
+
+	const size_t outSize = AAFUncompressedSize(aaf.data(), aaf.size());
+	std::unique_ptr<char[]> outBuffer(new char[outSize]);
+
+	if (maxThreads < 1)
+		maxThreads = 1;
+
+	AAFHeader hdr;
+	memcpy(&hdr, aaf.data(), sizeof(hdr));
+
+	printf("{\n\t\"compressedSize\": %zu,\n\t\"uncompressedSize\": %zu,\n\t\"numChunks\": %u,\n\t\"results\": [",
+		aaf.size(), outSize, hdr.numChunks);
+
+	for (int numThreads = 1; ; numThreads *= 2)
+	{
+		if (numThreads > maxThreads)
+			numThreads = maxThreads;
+
+		double bestTime = 1e30;
+		TaskScheduler scheduler(numThreads - 1);
+		TaskScheduler *usedScheduler = numThreads > 1 ? &scheduler : nullptr;
+
+		for (int r = 0; r < numRuns; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			AAFResult result = AAFDecompress(aaf.data(), aaf.size(), outBuffer.get(), outSize, usedScheduler);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (result != AAFResult_OK)
+			{
+				printf("\n]}\nDecompression failed: %i\n", result);
+				return 1;
+			}
+
+			if (!payload.empty() && memcmp(payload.data(), outBuffer.get(), outSize))
+			{
+				printf("\n]}\nDecompressed data mismatch.\n");
+				return 1;
+			}
+
+			if (elapsed.count() < bestTime)
+				bestTime = elapsed.count();
+		}
+
+		printf("%s\n\t\t{\"threads\": %i, \"seconds\": %.6f, \"MBps\": %.2f}", numThreads > 1 ? "," : "",
+			numThreads, bestTime, static_cast<double>(outSize) / (1 << 20) / bestTime);
+
+		if (numThreads >= maxThreads)
+			break;
+	}
+
+	printf("\n\t]\n}\n");
+
+	return 0;
+}
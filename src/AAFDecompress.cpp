@@ -0,0 +1,187 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AAFDecompress.h"
+#include "TaskScheduler.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+struct AAFChunk
+{
+	const char *source;
+	char *destination;
+	uint32_t compressedSize;
+	uint32_t uncompressedSize;
+};
+
+bool IsAAF(const char *data, size_t size)
+{
+	if (size < sizeof(AAFHeader))
+		return false;
+
+	AAFHeader hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	return hdr.magic == AAFHeader::ID && hdr.version == 1;
+}
+
+// Every chunk carries at least its header, anything above that is a broken count.
+static bool ValidChunkCount(const AAFHeader &hdr, size_t size)
+{
+	return hdr.numChunks <= (size - sizeof(AAFHeader)) / sizeof(AAFChunkHeader);
+}
+
+static bool ValidChunk(const AAFChunkHeader &chunkHdr, size_t chunkOffset, size_t size)
+{
+	return chunkHdr.magic == AAFHeader::CHUNK_ID &&
+		chunkHdr.chunkSize >= sizeof(AAFChunkHeader) + chunkHdr.compressedSize &&
+		chunkOffset + chunkHdr.chunkSize <= size;
+}
+
+// Walks the chunk table only, nothing is inflated.
+static bool ValidChunkTable(const char *data, size_t size)
+{
+	AAFHeader hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	if (!ValidChunkCount(hdr, size))
+		return false;
+
+	size_t chunkOffset = sizeof(AAFHeader);
+	size_t outOffset = 0;
+
+	for (uint32_t c = 0; c < hdr.numChunks; c++)
+	{
+		if (chunkOffset + sizeof(AAFChunkHeader) > size)
+			return false;
+
+		AAFChunkHeader chunkHdr;
+		memcpy(&chunkHdr, data + chunkOffset, sizeof(chunkHdr));
+
+		if (!ValidChunk(chunkHdr, chunkOffset, size))
+			return false;
+
+		outOffset += chunkHdr.uncompressedSize;
+		chunkOffset += chunkHdr.chunkSize;
+	}
+
+	return outOffset == hdr.uncompressedSize;
+}
+
+size_t AAFUncompressedSize(const char *data, size_t size)
+{
+	if (!IsAAF(data, size) || !ValidChunkTable(data, size))
+		return 0;
+
+	AAFHeader hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	return hdr.uncompressedSize;
+}
+
+static AAFResult CollectChunks(const char *data, size_t size, char *outBuffer, size_t outSize, std::vector<AAFChunk> &chunks)
+{
+	AAFHeader hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	if (outSize < hdr.uncompressedSize || !ValidChunkCount(hdr, size))
+		return AAFResult_Corrupted;
+
+	chunks.reserve(hdr.numChunks);
+
+	size_t chunkOffset = sizeof(AAFHeader);
+	size_t outOffset = 0;
+
+	for (uint32_t c = 0; c < hdr.numChunks; c++)
+	{
+		if (chunkOffset + sizeof(AAFChunkHeader) > size)
+			return AAFResult_Corrupted;
+
+		AAFChunkHeader chunkHdr;
+		memcpy(&chunkHdr, data + chunkOffset, sizeof(chunkHdr));
+
+		if (!ValidChunk(chunkHdr, chunkOffset, size) ||
+			outOffset + chunkHdr.uncompressedSize > hdr.uncompressedSize)
+			return AAFResult_Corrupted;
+
+		AAFChunk chunk;
+		chunk.source = data + chunkOffset + sizeof(AAFChunkHeader);
+		chunk.destination = outBuffer + outOffset;
+		chunk.compressedSize = chunkHdr.compressedSize;
+		chunk.uncompressedSize = chunkHdr.uncompressedSize;
+		chunks.push_back(chunk);
+
+		outOffset += chunkHdr.uncompressedSize;
+		chunkOffset += chunkHdr.chunkSize;
+	}
+
+	return outOffset == hdr.uncompressedSize ? AAFResult_OK : AAFResult_Corrupted;
+}
+
+static bool InflateChunk(const AAFChunk &chunk)
+{
+	if (chunk.compressedSize == chunk.uncompressedSize)
+	{
+		memcpy(chunk.destination, chunk.source, chunk.uncompressedSize);
+		return true;
+	}
+
+	z_stream stream = {};
+
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return false;
+
+	stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(chunk.source));
+	stream.avail_in = chunk.compressedSize;
+	stream.next_out = reinterpret_cast<Bytef *>(chunk.destination);
+	stream.avail_out = chunk.uncompressedSize;
+
+	const bool inflated = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == chunk.uncompressedSize;
+	inflateEnd(&stream);
+
+	return inflated;
+}
+
+AAFResult AAFDecompress(const char *data, size_t size, char *outBuffer, size_t outSize, TaskScheduler *scheduler)
+{
+	if (!IsAAF(data, size))
+		return AAFResult_NotAAF;
+
+	std::vector<AAFChunk> chunks;
+	AAFResult result = CollectChunks(data, size, outBuffer, outSize, chunks);
+
+	if (result != AAFResult_OK)
+		return result;
+
+	std::atomic<bool> failed(false);
+
+	auto inflateTask = [&](size_t c)
+	{
+		if (!failed && !InflateChunk(chunks[c]))
+			failed = true;
+	};
+
+	if (scheduler && chunks.size() > 1)
+		scheduler->ParallelFor(chunks.size(), inflateTask, TaskPriority_High);
+	else
+		for (size_t c = 0; c < chunks.size(); c++)
+			inflateTask(c);
+
+	return failed ? AAFResult_InflateError : AAFResult_OK;
+}
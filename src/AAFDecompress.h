@@ -0,0 +1,61 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+class TaskScheduler;
+
+enum AAFResult
+{
+	AAFResult_OK,
+	AAFResult_NotAAF,
+	AAFResult_Corrupted,
+	AAFResult_InflateError,
+};
+
+struct AAFHeader
+{
+	static const uint32_t ID = 0x464141; // AAF
+	static const uint32_t CHUNK_ID = 0x4D415745; // EWAM
+
+	uint32_t magic;
+	uint32_t version;
+	char comment[28];
+	uint32_t uncompressedSize;
+	uint32_t maxChunkSize;
+	uint32_t numChunks;
+};
+
+struct AAFChunkHeader
+{
+	uint32_t compressedSize;
+	uint32_t uncompressedSize;
+	uint32_t chunkSize;
+	uint32_t magic;
+};
+
+bool IsAAF(const char *data, size_t size);
+
+// Validates the chunk table before reporting a size, returns 0 for invalid data.
+size_t AAFUncompressedSize(const char *data, size_t size);
+
+// Every chunk is inflated as a separate task straight into its region of outBuffer.
+// outBuffer must hold AAFUncompressedSize bytes.
+// Without scheduler, chunks are inflated on the calling thread.
+AAFResult AAFDecompress(const char *data, size_t size, char *outBuffer, size_t outSize, TaskScheduler *scheduler = nullptr);
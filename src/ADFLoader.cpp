@@ -0,0 +1,281 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ADFLoader.h"
+#include "AAFDecompress.h"
+#include "TaskScheduler.h"
+#include "datas/binreader.hpp"
+#include "datas/masterprinter.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr) {}
+
+bool MappedFile::Open(const TCHAR *fileName)
+{
+	Close();
+
+	fileHandle = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || !fileSize.QuadPart)
+	{
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = static_cast<size_t>(fileSize.QuadPart);
+	importMemory.Allocate(MemoryCategory_Mapped, size);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+		importMemory.Free(MemoryCategory_Mapped, size);
+	}
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+MappedFile::MappedFile() : data(nullptr), size(0), fileHandle(-1) {}
+
+bool MappedFile::Open(const TCHAR *fileName)
+{
+	Close();
+
+	fileHandle = open(fileName, O_RDONLY);
+
+	if (fileHandle < 0)
+		return false;
+
+	struct stat fileStat;
+
+	if (fstat(fileHandle, &fileStat) || !fileStat.st_size)
+	{
+		Close();
+		return false;
+	}
+
+	void *mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileHandle, 0);
+
+	if (mapped == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	madvise(mapped, fileStat.st_size, MADV_SEQUENTIAL);
+	data = static_cast<const char *>(mapped);
+	size = static_cast<size_t>(fileStat.st_size);
+	importMemory.Allocate(MemoryCategory_Mapped, size);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+	{
+		munmap(const_cast<char *>(data), size);
+		importMemory.Free(MemoryCategory_Mapped, size);
+	}
+
+	if (fileHandle >= 0)
+		close(fileHandle);
+
+	data = nullptr;
+	size = 0;
+	fileHandle = -1;
+}
+#endif
+
+void MemoryStreamBuf::Assign(const char *data, size_t size)
+{
+	char *begin = const_cast<char *>(data);
+	setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if (!(which & std::ios_base::in))
+		return pos_type(off_type(-1));
+
+	char *target = nullptr;
+
+	switch (dir)
+	{
+	case std::ios_base::beg:
+		target = eback() + off;
+		break;
+	case std::ios_base::cur:
+		target = gptr() + off;
+		break;
+	default:
+		target = egptr() + off;
+		break;
+	}
+
+	if (target < eback() || target > egptr())
+		return pos_type(off_type(-1));
+
+	setg(eback(), target, egptr());
+
+	return pos_type(target - eback());
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+ADFHandle::ADFHandle() : decompressedSize(0), stream(&buffer), adf(nullptr) {}
+
+static bool IsAAFFile(const TCHAR *fileName)
+{
+	FILE *fle = _tfopen(fileName, _T("rb"));
+
+	if (!fle)
+		return false;
+
+	AAFHeader hdr;
+	const bool isAAF = fread(&hdr, sizeof(hdr), 1, fle) == 1 && IsAAF(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+	fclose(fle);
+
+	return isAAF;
+}
+
+bool ADFHandle::Load(const TCHAR *fileName)
+{
+	Release();
+
+	if (!IsAAFFile(fileName))
+	{
+		adf = IADF::Create(fileName);
+		return adf != nullptr;
+	}
+
+	if (!mapping.Open(fileName))
+		return false;
+
+	return CreateFromMemory(mapping.Data(), mapping.Size());
+}
+
+bool ADFHandle::Load(const char *data, size_t size)
+{
+	Release();
+
+	return CreateFromMemory(data, size);
+}
+
+bool ADFHandle::CreateFromMemory(const char *data, size_t size)
+{
+	if (IsAAF(data, size))
+	{
+		const size_t outSize = AAFUncompressedSize(data, size);
+
+		if (!outSize)
+		{
+			printerror("[Apex] Corrupted AAF header or chunk table.");
+			return false;
+		}
+
+		decompressed.reset(new char[outSize]);
+		decompressedSize = outSize;
+		importMemory.Allocate(MemoryCategory_ADF, outSize);
+
+		const AAFResult result = AAFDecompress(data, size, decompressed.get(), outSize, taskScheduler);
+
+		if (result != AAFResult_OK)
+		{
+			printerror("[Apex] Couldn't decompress AAF data, error: ", << static_cast<int>(result));
+			ReleaseDecompressed();
+			return false;
+		}
+
+		// The compressed source is no longer needed.
+		mapping.Close();
+		data = decompressed.get();
+		size = outSize;
+	}
+
+	buffer.Assign(data, size);
+	stream.clear();
+	stream.seekg(0);
+
+	BinReader rd(&stream);
+	adf = IADF::Create(&rd);
+
+	return adf != nullptr;
+}
+
+void ADFHandle::Release()
+{
+	if (adf)
+		delete adf;
+
+	adf = nullptr;
+	mapping.Close();
+	ReleaseDecompressed();
+}
+
+void ADFHandle::ReleaseDecompressed()
+{
+	importMemory.Free(MemoryCategory_ADF, decompressedSize);
+	decompressed.reset();
+	decompressedSize = 0;
+}
@@ -0,0 +1,87 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include "ApexCompat.h"
+#include "ImportMemory.h"
+#include "ApexApi.h"
+
+class MappedFile
+{
+	const char *data;
+	size_t size;
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#else
+	int fileHandle;
+#endif
+public:
+	MappedFile();
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool Open(const TCHAR *fileName);
+	void Close();
+
+	const char *Data() const { return data; }
+	size_t Size() const { return size; }
+};
+
+// Read only streambuf over an external memory block, nothing is copied.
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+	void Assign(const char *data, size_t size);
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+// Owns an IADF together with the memory it was parsed from.
+// AAF wrapped files are mapped and decompressed in parallel before parsing,
+// plain files go straight to IADF, which copies every buffer anyway.
+class ADFHandle
+{
+	MappedFile mapping;
+	std::unique_ptr<char[]> decompressed;
+	size_t decompressedSize;
+	MemoryStreamBuf buffer;
+	std::istream stream;
+	IADF *adf;
+
+	bool CreateFromMemory(const char *data, size_t size);
+	void ReleaseDecompressed();
+public:
+	ADFHandle();
+	~ADFHandle() { Release(); }
+	ADFHandle(const ADFHandle &) = delete;
+	ADFHandle &operator=(const ADFHandle &) = delete;
+
+	bool Load(const TCHAR *fileName);
+	bool Load(const char *data, size_t size);
+	void Release();
+
+	IADF *Get() const { return adf; }
+	IADF *operator->() const { return adf; }
+	operator bool() const { return adf != nullptr; }
+};
@@ -0,0 +1,393 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ApexArchive.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+#include "datas/masterprinter.hpp"
+
+#ifdef _WIN32
+#include <direct.h>
+typedef struct _stat64 StatType;
+#define StatFile _tstat64
+#define MakeDir(path) _tmkdir(path)
+#else
+typedef struct stat StatType;
+#define StatFile stat
+#define MakeDir(path) mkdir(path, 0755)
+#endif
+
+static const uint32_t tabMagic = 0x424154; // TAB
+static const uint32_t cacheMagic = 0x44495841; // AXID
+static const uint32_t cacheVersion = 2;
+
+#define HashRot(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+
+uint32_t ArchiveEntryHash(const char *path)
+{
+	std::string normalized = path;
+
+	for (char &c : normalized)
+		c = c == '\\' ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(c)));
+
+	const unsigned char *k = reinterpret_cast<const unsigned char *>(normalized.c_str());
+	size_t length = normalized.size();
+	uint32_t a, b, c;
+	a = b = c = 0xdeadbeef + static_cast<uint32_t>(length);
+
+	while (length > 12)
+	{
+		a += k[0] + (static_cast<uint32_t>(k[1]) << 8) + (static_cast<uint32_t>(k[2]) << 16) + (static_cast<uint32_t>(k[3]) << 24);
+		b += k[4] + (static_cast<uint32_t>(k[5]) << 8) + (static_cast<uint32_t>(k[6]) << 16) + (static_cast<uint32_t>(k[7]) << 24);
+		c += k[8] + (static_cast<uint32_t>(k[9]) << 8) + (static_cast<uint32_t>(k[10]) << 16) + (static_cast<uint32_t>(k[11]) << 24);
+
+		a -= c; a ^= HashRot(c, 4); c += b;
+		b -= a; b ^= HashRot(a, 6); a += c;
+		c -= b; c ^= HashRot(b, 8); b += a;
+		a -= c; a ^= HashRot(c, 16); c += b;
+		b -= a; b ^= HashRot(a, 19); a += c;
+		c -= b; c ^= HashRot(b, 4); b += a;
+
+		length -= 12;
+		k += 12;
+	}
+
+	switch (length)
+	{
+	case 12: c += static_cast<uint32_t>(k[11]) << 24; // fallthrough
+	case 11: c += static_cast<uint32_t>(k[10]) << 16; // fallthrough
+	case 10: c += static_cast<uint32_t>(k[9]) << 8; // fallthrough
+	case 9: c += k[8]; // fallthrough
+	case 8: b += static_cast<uint32_t>(k[7]) << 24; // fallthrough
+	case 7: b += static_cast<uint32_t>(k[6]) << 16; // fallthrough
+	case 6: b += static_cast<uint32_t>(k[5]) << 8; // fallthrough
+	case 5: b += k[4]; // fallthrough
+	case 4: a += static_cast<uint32_t>(k[3]) << 24; // fallthrough
+	case 3: a += static_cast<uint32_t>(k[2]) << 16; // fallthrough
+	case 2: a += static_cast<uint32_t>(k[1]) << 8; // fallthrough
+	case 1: a += k[0];
+		break;
+	case 0:
+		return c;
+	}
+
+	c ^= b; c -= HashRot(b, 14);
+	a ^= c; a -= HashRot(c, 11);
+	b ^= a; b -= HashRot(a, 25);
+	c ^= b; c -= HashRot(b, 16);
+	a ^= c; a -= HashRot(c, 4);
+	b ^= a; b -= HashRot(a, 14);
+	c ^= b; c -= HashRot(b, 24);
+
+	return c;
+}
+
+static TSTRING ReplaceExtension(const TSTRING &path, const TCHAR *extension)
+{
+	const size_t dot = path.find_last_of('.');
+	return (dot == TSTRING::npos ? path : path.substr(0, dot)) + extension;
+}
+
+bool ArchiveIndex::Open(const TCHAR *archivePath, const TCHAR *cacheFolder)
+{
+	tabPath = ReplaceExtension(archivePath, _T(".tab"));
+	arcPath = ReplaceExtension(archivePath, _T(".arc"));
+	entries.clear();
+	archive.Close();
+
+	StatType tabStat;
+
+	if (StatFile(tabPath.c_str(), &tabStat))
+	{
+		printerror("[Apex] Couldn't find archive table: ", << tabPath.c_str());
+		return false;
+	}
+
+	const uint64_t tabSize = tabStat.st_size;
+	const uint64_t tabTime = tabStat.st_mtime;
+	TSTRING cachePath;
+
+	if (cacheFolder && *cacheFolder)
+	{
+		char hashName[16];
+		snprintf(hashName, sizeof(hashName), "%08X.idx", ArchiveEntryHash(std::string(esString(tabPath)).c_str()));
+
+		cachePath = cacheFolder;
+		MakeDir(cachePath.c_str());
+		cachePath.push_back('/');
+		cachePath.append(esString(hashName));
+
+		if (LoadCache(cachePath, tabSize, tabTime))
+			return true;
+	}
+
+	if (!LoadTab())
+		return false;
+
+	if (!cachePath.empty())
+		SaveCache(cachePath, tabSize, tabTime);
+
+	return true;
+}
+
+bool ArchiveIndex::LoadTab()
+{
+	MappedFile tab;
+
+	if (!tab.Open(tabPath.c_str()) || tab.Size() < 4)
+	{
+		printerror("[Apex] Couldn't read archive table: ", << tabPath.c_str());
+		return false;
+	}
+
+	const uint32_t *header = reinterpret_cast<const uint32_t *>(tab.Data());
+
+	// JC3 starts with 12 byte TAB header of magic, version and alignment, JC2 with 4 byte block alignment only.
+	// Both layouts are followed by 12 byte hash/offset/size entries.
+	size_t headerSize = 4;
+
+	if (header[0] == tabMagic)
+	{
+		if (tab.Size() < 12)
+		{
+			printerror("[Apex] Archive table is truncated: ", << tabPath.c_str());
+			return false;
+		}
+
+		if ((header[1] & 0xffff) != 2)
+		{
+			printerror("[Apex] Unsupported archive table version: ", << (header[1] & 0xffff) << ", " << tabPath.c_str());
+			return false;
+		}
+
+		headerSize = 12;
+	}
+
+	if ((tab.Size() - headerSize) % sizeof(Entry))
+	{
+		printerror("[Apex] Archive table is truncated: ", << tabPath.c_str());
+		return false;
+	}
+
+	const size_t numEntries = (tab.Size() - headerSize) / sizeof(Entry);
+	const Entry *tabEntries = reinterpret_cast<const Entry *>(tab.Data() + headerSize);
+
+	entries.assign(tabEntries, tabEntries + numEntries);
+	std::sort(entries.begin(), entries.end(), [](const Entry &e0, const Entry &e1) { return e0.hash < e1.hash; });
+
+	return true;
+}
+
+bool ArchiveIndex::LoadCache(const TSTRING &cachePath, uint64_t tabSize, uint64_t tabTime)
+{
+	MappedFile cache;
+
+	if (!cache.Open(cachePath.c_str()))
+		return false;
+
+	struct
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t tabSize;
+		uint64_t tabTime;
+		uint64_t numEntries;
+	}header;
+
+	if (cache.Size() < sizeof(header))
+		return false;
+
+	memcpy(&header, cache.Data(), sizeof(header));
+
+	if (header.magic != cacheMagic || header.version != cacheVersion || header.tabSize != tabSize ||
+		header.tabTime != tabTime || cache.Size() != sizeof(header) + header.numEntries * sizeof(Entry))
+		return false;
+
+	const Entry *cacheEntries = reinterpret_cast<const Entry *>(cache.Data() + sizeof(header));
+	entries.assign(cacheEntries, cacheEntries + header.numEntries);
+
+	return true;
+}
+
+void ArchiveIndex::SaveCache(const TSTRING &cachePath, uint64_t tabSize, uint64_t tabTime) const
+{
+	FILE *fle = _tfopen(cachePath.c_str(), _T("wb"));
+
+	if (!fle)
+		return;
+
+	struct
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t tabSize;
+		uint64_t tabTime;
+		uint64_t numEntries;
+	}header = { cacheMagic, cacheVersion, tabSize, tabTime, entries.size() };
+
+	fwrite(&header, sizeof(header), 1, fle);
+	fwrite(entries.data(), sizeof(Entry), entries.size(), fle);
+	fclose(fle);
+}
+
+const ArchiveIndex::Entry *ArchiveIndex::Find(uint32_t hash) const
+{
+	auto found = std::lower_bound(entries.begin(), entries.end(), hash, [](const Entry &e, uint32_t h) { return e.hash < h; });
+
+	if (found == entries.end() || found->hash != hash)
+		return nullptr;
+
+	return &*found;
+}
+
+const char *ArchiveIndex::Data(const Entry &entry)
+{
+	if (!archive.Data() && !archive.Open(arcPath.c_str()))
+	{
+		printerror("[Apex] Couldn't open archive: ", << arcPath.c_str());
+		return nullptr;
+	}
+
+	if (static_cast<size_t>(entry.offset) + entry.size > archive.Size())
+	{
+		printerror("[Apex] Archive entry out of bounds: ", << arcPath.c_str());
+		return nullptr;
+	}
+
+	return archive.Data() + entry.offset;
+}
+
+ArchiveIndex *ArchiveSet::Open(const TCHAR *archivePath)
+{
+	const TSTRING tabPath = ReplaceExtension(archivePath, _T(".tab"));
+
+	for (auto &a : archives)
+		if (a->TabPath() == tabPath)
+			return a.get();
+
+	std::unique_ptr<ArchiveIndex> index(new ArchiveIndex);
+
+	if (!index->Open(tabPath.c_str(), cacheFolder.c_str()))
+		return nullptr;
+
+	archives.push_back(std::move(index));
+
+	return archives.back().get();
+}
+
+void ArchiveSet::OpenList(const TCHAR *archiveList)
+{
+	TSTRING path;
+
+	for (const TCHAR *c = archiveList; ; c++)
+	{
+		if (*c && *c != ';')
+		{
+			path.push_back(*c);
+			continue;
+		}
+
+		if (!path.empty())
+			Open(path.c_str());
+
+		path.clear();
+
+		if (!*c)
+			break;
+	}
+}
+
+ArchiveIndex *ArchiveSet::Find(const char *path, const ArchiveIndex::Entry *&outEntry) const
+{
+	const uint32_t hash = ArchiveEntryHash(path);
+
+	for (auto &a : archives)
+	{
+		outEntry = a->Find(hash);
+
+		if (outEntry)
+			return a.get();
+	}
+
+	return nullptr;
+}
+
+bool ArchiveSet::ExtractEntry(const char *path, TSTRING &outPath) const
+{
+	const ArchiveIndex::Entry *entry = nullptr;
+	ArchiveIndex *index = Find(path, entry);
+
+	if (!index)
+		return false;
+
+	TSTRING extractedPath = cacheFolder;
+	MakeDir(extractedPath.c_str());
+
+	const TSTRING relPath = esString(path);
+	size_t lastPos = 0;
+
+	for (size_t p = relPath.find_first_of(_T("/\\")); p != TSTRING::npos; p = relPath.find_first_of(_T("/\\"), p + 1))
+	{
+		extractedPath.push_back('/');
+		extractedPath.append(relPath, lastPos, p - lastPos);
+		MakeDir(extractedPath.c_str());
+		lastPos = p + 1;
+	}
+
+	extractedPath.push_back('/');
+	extractedPath.append(relPath, lastPos, TSTRING::npos);
+
+	StatType extractedStat;
+
+	if (StatFile(extractedPath.c_str(), &extractedStat) || static_cast<uint64_t>(extractedStat.st_size) != entry->size)
+	{
+		const char *data = index->Data(*entry);
+
+		if (!data)
+			return false;
+
+		FILE *fle = _tfopen(extractedPath.c_str(), _T("wb"));
+
+		if (!fle)
+			return false;
+
+		const bool written = fwrite(data, 1, entry->size, fle) == entry->size;
+		fclose(fle);
+
+		if (!written)
+			return false;
+	}
+
+	outPath = extractedPath;
+
+	return true;
+}
+
+bool SplitArchivePath(const TCHAR *fileName, TSTRING &archivePath, std::string &entryPath)
+{
+	const TSTRING name = fileName;
+	const size_t found = name.find(_T("::"));
+
+	if (found == TSTRING::npos)
+		return false;
+
+	archivePath = name.substr(0, found);
+	entryPath = esString(name.substr(found + 2));
+
+	return true;
+}
@@ -0,0 +1,86 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "ADFLoader.h"
+#include "datas/esstring.h"
+
+// Jenkins lookup3 (hashlittle) of a lowercased, forward slashed entry path.
+uint32_t ArchiveEntryHash(const char *path);
+
+// Index of a single .tab/.arc pair.
+// The .tab is parsed only once, sorted entries are cached into cacheFolder.
+class ArchiveIndex
+{
+public:
+	struct Entry
+	{
+		uint32_t hash;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+private:
+	TSTRING tabPath;
+	TSTRING arcPath;
+	std::vector<Entry> entries;
+	MappedFile archive;
+
+	bool LoadTab();
+	bool LoadCache(const TSTRING &cachePath, uint64_t tabSize, uint64_t tabTime);
+	void SaveCache(const TSTRING &cachePath, uint64_t tabSize, uint64_t tabTime) const;
+
+public:
+	bool Open(const TCHAR *archivePath, const TCHAR *cacheFolder);
+
+	const Entry *Find(uint32_t hash) const;
+	const Entry *Find(const char *path) const { return Find(ArchiveEntryHash(path)); }
+
+	// Returns entry data straight from the mapped .arc, nullptr on failure.
+	const char *Data(const Entry &entry);
+
+	const TSTRING &TabPath() const { return tabPath; }
+	size_t NumEntries() const { return entries.size(); }
+};
+
+class ArchiveSet
+{
+	std::vector<std::unique_ptr<ArchiveIndex>> archives;
+	TSTRING cacheFolder;
+public:
+	void SetCacheFolder(const TCHAR *folder) { cacheFolder = folder; }
+	const TSTRING &CacheFolder() const { return cacheFolder; }
+
+	// Accepts either .tab or .arc path, opened archives are reused.
+	ArchiveIndex *Open(const TCHAR *archivePath);
+
+	// Semicolon separated list of archive paths.
+	void OpenList(const TCHAR *archiveList);
+
+	bool Empty() const { return archives.empty(); }
+	ArchiveIndex *Find(const char *path, const ArchiveIndex::Entry *&outEntry) const;
+
+	// Writes a single entry under cacheFolder, keeping its relative path.
+	// Used for files that can't be read from memory, e.g. bitmaps.
+	bool ExtractEntry(const char *path, TSTRING &outPath) const;
+};
+
+// Splits "archive.arc::path/to/file.modelc" style names.
+bool SplitArchivePath(const TCHAR *fileName, TSTRING &archivePath, std::string &entryPath);
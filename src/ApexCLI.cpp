@@ -0,0 +1,207 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Headless decoder, runs the whole format to staging path without 3ds Max.
+// Usage: apexmax-cli [-scale N] [-lods LIST] [-region TEXT] [-threads N] [-bounds] [-optimize] [-trace FILE] file...
+// Accepts modelc, rbm, rbn and vmodc files, prints statistics and timings for each.
+// Synthetic test files are accepted only in builds with APEXMAX_SYNTHETIC_MODELS option.
+// -bounds stages the same way as proxy import does, it decodes positions only, -region takes the same text as Advanced/Region setting.
+// -lods, -region and -bounds skip decoding only, IADF still reads every buffer of the file.
+// -optimize reorders meshes like Advanced/OptimizeMeshes setting, ACMR is simulated on a 16 entry FIFO cache.
+
+#include "ModelStaging.h"
+#include "ImportProfiler.h"
+#include "StagingKernels.h"
+#include "SyntheticModel.h"
+#include "TaskScheduler.h"
+#include "datas/masterprinter.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void PrintStdout(TCHAR *msg)
+{
+	fputs(msg, stdout);
+}
+
+struct ModelStats
+{
+	int numLODs = 0;
+	int numMeshes = 0;
+	int numUVChannels = 0;
+	int numSkinned = 0;
+	int numMorphed = 0;
+	int numTextures = 0;
+	int64_t numVertices = 0;
+	int64_t numFaces = 0;
+	int64_t stagedBytes = 0;
+	int64_t numMeshFaces = 0; // without stunt areas, ACMR covers these
+	double cacheMisses = 0.0;
+};
+
+static ModelStats CollectStats(const ModelStaging &staging)
+{
+	ModelStats stats;
+	stats.numLODs = static_cast<int>(staging.lods.size());
+
+	for (auto &lod : staging.lods)
+		for (auto &mesh : lod.meshes)
+		{
+			stats.numMeshes++;
+			stats.numVertices += mesh.numVertices;
+			stats.numFaces += mesh.numFaces;
+			stats.numMeshFaces += mesh.faces.size();
+			stats.numUVChannels += static_cast<int>(mesh.uvChannels.size());
+			stats.numSkinned += mesh.skin.Valid();
+			stats.numMorphed += mesh.morph.Valid();
+			stats.stagedBytes += (mesh.positions.size() + mesh.normals.size() + mesh.colors.size() + mesh.morph.deltas.size()) * sizeof(Vector) +
+				mesh.uvChannels.size() * mesh.numVertices * sizeof(Vector) + mesh.faces.size() * sizeof(USVector) +
+				mesh.skin.indices.size() * (sizeof(uchar) + sizeof(float));
+			stats.cacheMisses += VertexCacheACMR(reinterpret_cast<const uint16_t *>(mesh.faces.data()), mesh.faces.size() * 3,
+				mesh.numVertices, 16) * mesh.faces.size();
+		}
+
+	for (auto &area : staging.stuntAreas)
+	{
+		stats.numMeshes++;
+		stats.numVertices += area.vertices.size();
+		stats.numFaces += area.indices.size() / 3;
+		stats.stagedBytes += area.vertices.size() * sizeof(Vector) + area.indices.size() * sizeof(int);
+	}
+
+	for (auto &mat : staging.materials)
+		for (auto &tex : mat.textures)
+			stats.numTextures += !tex.empty();
+
+	return stats;
+}
+
+int main(int argc, char *argv[])
+{
+	StagingSettings settings;
+	settings.scale = 1.0f;
+	int numWorkers = 0;
+	const char *tracePath = nullptr;
+	std::vector<const char *> files;
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-scale") && a + 1 < argc)
+			settings.scale = static_cast<float>(atof(argv[++a]));
+		else if (!strcmp(argv[a], "-lods") && a + 1 < argc)
+			settings.lodFilter.Parse(argv[++a]);
+		else if (!strcmp(argv[a], "-region") && a + 1 < argc)
+		{
+			if (!settings.region.Parse(argv[++a]))
+			{
+				printf("Invalid region: %s\n", argv[a]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[a], "-threads") && a + 1 < argc)
+			numWorkers = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-bounds"))
+			settings.boundsOnly = true;
+		else if (!strcmp(argv[a], "-optimize"))
+			settings.optimizeMeshes = true;
+		else if (!strcmp(argv[a], "-trace") && a + 1 < argc)
+			tracePath = argv[++a];
+		else
+			files.push_back(argv[a]);
+	}
+
+	if (files.empty())
+	{
+		printf("Usage: apexmax-cli [-scale N] [-lods LIST] [-region TEXT] [-threads N] [-bounds] [-optimize] [-trace FILE] file...\n"
+			"-lods, -region and -bounds skip decoding only, every buffer of the file is still read.\n");
+		return 1;
+	}
+
+	printer.AddPrinterFunction(PrintStdout);
+	taskScheduler = new TaskScheduler(numWorkers);
+	importProfiler.Reset();
+
+	if (tracePath)
+		importTrace.Begin();
+
+	int numFailed = 0;
+	const Clock::time_point totalStart = Clock::now();
+
+	for (const char *fileName : files)
+	{
+		ModelStaging staging;
+		ScopedArena arena(&staging.arena);
+		const Clock::time_point loadStart = Clock::now();
+		bool loaded;
+
+		{
+			ScopedPhase phase(ImportPhase_FileLoad, fileName);
+			loaded = LoadSyntheticModel(fileName, staging.syntheticData) || staging.adf.Load(fileName);
+		}
+
+		if (!loaded)
+		{
+			printf("%s: couldn't load file.\n", fileName);
+			numFailed++;
+			continue;
+		}
+
+		importProfiler.Add(ImportCounter_Files);
+
+		const Clock::time_point stageStart = Clock::now();
+		const bool staged = staging.syntheticData.size() ? StageSyntheticModel(staging, settings) :
+			StageStuntAreas(staging, settings) || StageModel(staging, settings);
+		const Clock::time_point stageEnd = Clock::now();
+
+		if (!staged)
+		{
+			printf("%s: not a model or stunt area file.\n", fileName);
+			numFailed++;
+			continue;
+		}
+
+		const ModelStats stats = CollectStats(staging);
+		const double loadTime = std::chrono::duration<double>(stageStart - loadStart).count();
+		const double stageTime = std::chrono::duration<double>(stageEnd - stageStart).count();
+
+		printf("%s:\n", fileName);
+		printf("\tload: %.6fs, stage: %.6fs, %.2f Mverts/s\n", loadTime, stageTime,
+			stageTime > 0.0 ? stats.numVertices / stageTime * 1e-6 : 0.0);
+		printf("\tLODs: %i, meshes: %i, vertices: %lld, faces: %lld, uv channels: %i\n", stats.numLODs, stats.numMeshes,
+			static_cast<long long>(stats.numVertices), static_cast<long long>(stats.numFaces), stats.numUVChannels);
+		printf("\tskinned: %i, morphed: %i, materials: %i, textures: %i, stunt areas: %i\n", stats.numSkinned, stats.numMorphed,
+			static_cast<int>(staging.materials.size()), stats.numTextures, static_cast<int>(staging.stuntAreas.size()));
+		printf("\tstaged memory: %.2f MB, ACMR: %.3f\n", stats.stagedBytes / (1024.0 * 1024.0),
+			stats.numMeshFaces ? stats.cacheMisses / stats.numMeshFaces : 0.0);
+	}
+
+	importProfiler.AddTime(ImportPhase_Total, Clock::now() - totalStart);
+	importProfiler.Finish();
+	importProfiler.Report();
+
+	if (tracePath && !importTrace.End(tracePath))
+		printf("Couldn't write trace: %s\n", tracePath);
+
+	delete taskScheduler;
+	taskScheduler = nullptr;
+
+	return numFailed ? 2 : 0;
+}
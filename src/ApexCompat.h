@@ -0,0 +1,37 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Generic text mappings used by Max independent code, so it also builds on Linux.
+#ifdef _WIN32
+#include <tchar.h>
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+#include <sys/stat.h>
+
+typedef char TCHAR;
+#define _T(x) x
+#define _tfopen fopen
+#define _tcsicmp strcasecmp
+#define _tcsnicmp strncasecmp
+#define _tcstod strtod
+#define _ttoi atoi
+#define _tmkdir(path) mkdir(path, 0755)
+#endif
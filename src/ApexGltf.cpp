@@ -0,0 +1,113 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Headless glTF 2.0 exporter, converts a model through the same staging path as the importer.
+// Usage: apexmax-gltf [-scale N] [-lods LIST] [-threads N] [-optimize] input output
+// -lods skips decoding of other LODs, every buffer of the file is still read.
+// Output with .glb extension is a binary container, .gltf writes json and a .bin next to it.
+
+#include "GltfExport.h"
+#include "SyntheticModel.h"
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char *argv[])
+{
+	StagingSettings settings;
+	int numWorkers = 0;
+	const char *inputPath = nullptr;
+	const char *outputPath = nullptr;
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-scale") && a + 1 < argc)
+			settings.scale = static_cast<float>(atof(argv[++a]));
+		else if (!strcmp(argv[a], "-lods") && a + 1 < argc)
+			settings.lodFilter.Parse(argv[++a]);
+		else if (!strcmp(argv[a], "-threads") && a + 1 < argc)
+			numWorkers = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-optimize"))
+			settings.optimizeMeshes = true;
+		else if (!inputPath)
+			inputPath = argv[a];
+		else
+			outputPath = argv[a];
+	}
+
+	if (!inputPath || !outputPath)
+	{
+		printf("Usage: apexmax-gltf [-scale N] [-lods LIST] [-threads N] [-optimize] input output\n");
+		return 1;
+	}
+
+	taskScheduler = new TaskScheduler(numWorkers);
+
+	int result = 0;
+
+	{
+		ModelStaging staging;
+		ScopedArena arena(&staging.arena);
+		const Clock::time_point loadStart = Clock::now();
+		const bool loaded = LoadSyntheticModel(inputPath, staging.syntheticData) || staging.adf.Load(inputPath);
+		const Clock::time_point stageStart = Clock::now();
+		const bool staged = loaded && (staging.syntheticData.size() ? StageSyntheticModel(staging, settings) : StageModel(staging, settings));
+		const Clock::time_point exportStart = Clock::now();
+		GltfExportStats stats;
+
+		if (!loaded)
+		{
+			printf("%s: couldn't load file.\n", inputPath);
+			result = 2;
+		}
+		else if (!staged)
+		{
+			printf("%s: not a model file.\n", inputPath);
+			result = 2;
+		}
+		else if (!ExportGltf(staging, outputPath, stats))
+		{
+			printf("Couldn't write: %s\n", outputPath);
+			result = 2;
+		}
+		else
+		{
+			const Clock::time_point exportEnd = Clock::now();
+			const double loadTime = std::chrono::duration<double>(stageStart - loadStart).count();
+			const double stageTime = std::chrono::duration<double>(exportStart - stageStart).count();
+			const double exportTime = std::chrono::duration<double>(exportEnd - exportStart).count();
+			const double totalSize = static_cast<double>(stats.jsonSize + stats.bufferSize);
+
+			printf("%s:\n", outputPath);
+			printf("\tload: %.6fs, stage: %.6fs, export: %.6fs, %.1f MB/s\n", loadTime, stageTime, exportTime,
+				exportTime > 0.0 ? totalSize / exportTime / (1024.0 * 1024.0) : 0.0);
+			printf("\tLODs: %i, meshes: %i, joints: %i, morph targets: %i\n", static_cast<int>(staging.lods.size()), stats.numMeshes,
+				stats.numJoints, stats.numTargets);
+			printf("\tjson: %.2f KB, buffer: %.2f MB, converted: %.2f MB\n", stats.jsonSize / 1024.0, stats.bufferSize / (1024.0 * 1024.0),
+				stats.copiedSize / (1024.0 * 1024.0));
+		}
+	}
+
+	delete taskScheduler;
+	taskScheduler = nullptr;
+
+	return result;
+}
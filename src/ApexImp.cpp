@@ -15,18 +15,34 @@
 	along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+#include <future>
 #include <map>
+#include <unordered_map>
 
 #include <triobj.h>
+#include <simpobj.h>
+#include <meshadj.h>
+#include <namesel.h>
+#include <hold.h>
+#include <macrorec.h>
 #include <ilayermanager.h>
 #include <ilayer.h>
 #include <iskin.h>
 #include "../samples/modifiers/morpher/include/MorpherApi.h"
 #include "MeshNormalSpec.h"
+#include <maxscript/foundation/arrays.h>
+#include <maxscript/foundation/numbers.h>
+#include <maxscript/foundation/strings.h>
 #include "IXTexmaps.h"
 #include "ApexMax.h"
+#include "LogSink.h"
+#include "ADFLoader.h"
+#include "ApexArchive.h"
+#include "TaskScheduler.h"
+#include "ImportProfiler.h"
+#include <IPathConfigMgr.h>
 
-#include "StuntAreas.h"
 
 #include "datas/esstring.h"
 #include "datas/masterprinter.hpp"
@@ -35,8 +51,19 @@
 
 
 #define ApexImp_CLASS_ID	Class_ID(0x85965629, 0x96893331)
+#define ApexImpInterface_ID Interface_ID(0x5b2e1a47, 0x1d6c3f20)
 static const TCHAR _className[] = _T("ApexImp");
 
+// Either a file on disk or an archive entry already resolved into memory.
+struct ImportSource
+{
+	TSTRING fileName;
+	const char *data;
+	size_t size;
+};
+
+class ModelMaterials;
+
 class ApexImp : public SceneImport, ApexImport
 {
 public:
@@ -57,11 +84,26 @@ public:
 	// Show DLL's "About..." box
 	virtual int				DoImport(const TCHAR *name, ImpInterface *i, Interface *gi, BOOL suppressPrompts = FALSE);	// Import file
 
-	INodeSuffixer LoadMesh(AmfMesh *imsh);
+	TriObject *BuildMesh(MeshStaging &staging, INodeSuffixer &nde);
+	INodeSuffixer LoadMesh(MeshStaging &staging);
 	void LoadSpriteData(AmfMesh *mesh, INode *nde);
-	void ApplyDeform(AmfMesh *mesh, INodeSuffixer &nde);
-	int LoadModel(IADF * adf);
-	int LoadStuntArea(IADF * adf);
+	void ApplyDeform(const MeshStaging &staging, INodeSuffixer &nde);
+	void NameNode(const MeshStaging &staging, INodeSuffixer &nde);
+	void RebuildNode(INode *node, MeshStaging &staging, bool geometry);
+	int LoadModel(ModelStaging &staging, const TCHAR *filename);
+	int LoadProxies(ModelStaging &staging, const TCHAR *filename);
+	bool ExpandProxy(INode *node, ModelStaging &staging, ModelMaterials &materials, const TCHAR *filename);
+	int ExpandProxies();
+	int LoadStuntArea(ModelStaging &staging);
+
+	void BeginImport();
+	void EndImport();
+	bool ResolveSource(const TCHAR *filename, ImportSource &source);
+	StagingSettings ImportSettings() const;
+	bool StageFile(const ImportSource &source, ModelStaging &staging, const StagingSettings &settings);
+	int CommitFile(const TCHAR *filename, ModelStaging &staging);
+	Value *ImportBatch(Tab<const TCHAR *> &files, int lookahead, bool bulk);
+	void SetArchives(const TCHAR *archives);
 };
 
 
@@ -82,6 +124,162 @@ public:
 
 ClassDesc2* GetApexImpDesc() { return &apexImpDesc; }
 
+// MAXScript: apexImport.batch #("a.modelc", "b.rbm") lookahead:2 bulk:true
+// bulk:false commits without BulkCommit, to compare commit times.
+// Archive entries are passed as "game0.arc::models/a.modelc".
+// MAXScript: apexImport.setArchives "C:/game/archives_win64/game0.tab;C:/game/archives_win64/game1.tab"
+// Stores Advanced/Archives setting, textures of imported materials are looked up in these archives.
+// Returns #(#(file, imported, stageSeconds, commitSeconds), ...)
+// MAXScript: apexImport.expandProxies()
+// Replaces selected bounding box proxies with full meshes, returns number of expanded nodes.
+// MAXScript: apexImport.getStats()
+// Returns profile of the last import:
+// #(#(phase, seconds, calls, rssGrowthMB, peakRssMB), ..., #(counter, count), ..., #(memoryCategory, peakMB), ...)
+class ApexImpInterface : public FPStaticInterface
+{
+public:
+	enum { fnBatch, fnExpandProxies, fnGetStats, fnSetArchives };
+
+	Value *Batch(Tab<const TCHAR *> *files, int lookahead, BOOL bulk)
+	{
+		ApexImp imp;
+		return imp.ImportBatch(*files, lookahead, bulk != FALSE);
+	}
+
+	int ExpandProxies()
+	{
+		ApexImp imp;
+		return imp.ExpandProxies();
+	}
+
+	void SetArchives(const TCHAR *archives)
+	{
+		ApexImp imp;
+		imp.SetArchives(archives);
+	}
+
+	// Nested phases don't sample RSS, their growth and peak are 0.
+	Value *GetStats()
+	{
+		one_typed_value_local(Array *result);
+		vl.result = new Array(ImportPhase_Count + ImportCounter_Count + MemoryCategory_Count);
+		static const float toMB = 1.0f / (1024.0f * 1024.0f);
+
+		for (int p = 0; p < ImportPhase_Count; p++)
+		{
+			const ImportPhase phase = static_cast<ImportPhase>(p);
+			Array *entry = new Array(5);
+			entry->append(new String(static_cast<TSTRING>(esString(ImportProfiler::PhaseName(phase))).c_str()));
+			entry->append(Float::intern(static_cast<float>(importProfiler.Seconds(phase))));
+			entry->append(Integer::intern(importProfiler.Calls(phase)));
+			entry->append(Float::intern(importProfiler.RSSGrowth(phase) * toMB));
+			entry->append(Float::intern(importProfiler.PeakRSS(phase) * toMB));
+			vl.result->append(entry);
+		}
+
+		for (int c = 0; c < ImportCounter_Count; c++)
+		{
+			const ImportCounter counter = static_cast<ImportCounter>(c);
+			Array *entry = new Array(2);
+			entry->append(new String(static_cast<TSTRING>(esString(ImportProfiler::CounterName(counter))).c_str()));
+			entry->append(Integer::intern(static_cast<int>(importProfiler.Count(counter))));
+			vl.result->append(entry);
+		}
+
+		for (int c = 0; c < MemoryCategory_Count; c++)
+		{
+			const MemoryCategory category = static_cast<MemoryCategory>(c);
+			Array *entry = new Array(2);
+			entry->append(new String(static_cast<TSTRING>(esString(ImportMemory::CategoryName(category))).c_str()));
+			entry->append(Float::intern(importMemory.Peak(category) * toMB));
+			vl.result->append(entry);
+		}
+
+		return_value(vl.result);
+	}
+
+	DECLARE_DESCRIPTOR(ApexImpInterface)
+
+	BEGIN_FUNCTION_MAP
+		FN_3(fnBatch, TYPE_VALUE, Batch, TYPE_STRING_TAB, TYPE_INT, TYPE_BOOL)
+		FN_0(fnExpandProxies, TYPE_INT, ExpandProxies)
+		FN_0(fnGetStats, TYPE_VALUE, GetStats)
+		VFN_1(fnSetArchives, SetArchives, TYPE_STRING)
+	END_FUNCTION_MAP
+};
+
+static ApexImpInterface apexImpInterface(
+	ApexImpInterface_ID, _T("apexImport"), 0, &apexImpDesc, 0,
+	ApexImpInterface::fnBatch, _T("batch"), 0, TYPE_VALUE, 0, 3,
+		_T("files"), 0, TYPE_STRING_TAB,
+		_T("lookahead"), 0, TYPE_INT, f_keyArgDefault, 2,
+		_T("bulk"), 0, TYPE_BOOL, f_keyArgDefault, TRUE,
+	ApexImpInterface::fnExpandProxies, _T("expandProxies"), 0, TYPE_INT, 0, 0,
+	ApexImpInterface::fnGetStats, _T("getStats"), 0, TYPE_VALUE, 0, 0,
+	ApexImpInterface::fnSetArchives, _T("setArchives"), 0, TYPE_VOID, 0, 1,
+		_T("archives"), 0, TYPE_STRING,
+	p_end
+);
+
+// Scene commit without undo records, viewport redraws and reference messages.
+// Reference messages are replayed for nodes created in the scope once it ends.
+class BulkCommit
+{
+	std::vector<INode *> nodes;
+	BulkCommit *previous;
+
+	static BulkCommit *current;
+
+public:
+	BulkCommit() : previous(current)
+	{
+		current = this;
+		theHold.Suspend();
+		macroRecorder->Disable();
+		GetCOREInterface()->DisableSceneRedraw();
+		DisableRefMsgs();
+	}
+
+	~BulkCommit()
+	{
+		ScopedPhase phase(ImportPhase_CommitFlush);
+		EnableRefMsgs();
+
+		for (INode *n : nodes)
+		{
+			n->InvalidateTreeTM();
+			n->GetObjectRef()->NotifyDependents(FOREVER, PART_ALL, REFMSG_CHANGE);
+		}
+
+		GetCOREInterface()->EnableSceneRedraw();
+		macroRecorder->Enable();
+		theHold.Resume();
+		current = previous;
+
+		if (!current)
+			GetCOREInterface()->RedrawViews(GetCOREInterface()->GetTime());
+	}
+
+	BulkCommit(const BulkCommit &) = delete;
+	BulkCommit &operator=(const BulkCommit &) = delete;
+
+	static void Track(INode *node)
+	{
+		if (current)
+			current->nodes.push_back(node);
+	}
+};
+
+BulkCommit *BulkCommit::current = nullptr;
+
+static INode *CreateSceneNode(Object *obj)
+{
+	INode *node = GetCOREInterface()->CreateObjectNode(obj);
+	BulkCommit::Track(node);
+
+	return node;
+}
+
 //--- ApexImp -------------------------------------------------------
 ApexImp::ApexImp()
 {
@@ -155,19 +353,24 @@ void ApexImp::ShowAbout(HWND hWnd)
 	ShowAboutDLG(hWnd);
 }
 
-Mtl *CreateMaterial(AmfMaterial *material);
+Mtl *CreateMaterial(AmfMaterial *material, bool forceStandard, const ArchiveSet *archives);
+
+static ArchiveSet iArchives;
 
 static class : public ITreeEnumProc
 {
 	const MSTR skelNameHint = _T("hkaSkeleton");
 	const MSTR boneNameHint = _T("hkaBone");
 	const MSTR skelNameExclude = _T("ragdoll");
+	// Scene nodes by name, filled by the same scan so name lookups don't walk the scene each time.
+	std::unordered_map<TSTRING, INode *> names;
 public:
 	std::vector<INode*> bones;
 
 	void RescanBones()
 	{
 		bones.clear();
+		names.clear();
 		GetCOREInterface7()->GetScene()->EnumTree(this);
 	}
 
@@ -191,23 +394,33 @@ public:
 
 	INode *LookupNode(TSTRING &boneName)
 	{
+		auto found = names.find(boneName);
+
+		if (found != names.end())
+			return found->second;
+
 		INode *node = GetCOREInterface()->GetINodeByName(boneName.c_str());
 
 		if (!node)
 		{
 			Object *obj = static_cast<Object*>(CreateInstance(HELPER_CLASS_ID, Class_ID(DUMMY_CLASS_ID, 0)));
-			node = GetCOREInterface()->CreateObjectNode(obj);
+			node = CreateSceneNode(obj);
 			node->ShowBone(2);
 			node->SetWireColor(0x80ff);
 			node->SetName(ToBoneName(boneName));
 			bones.push_back(node);
+			importProfiler.Add(ImportCounter_Bones);
 		}
 
+		names[boneName] = node;
+
 		return node;
 	}
 
 	int callback(INode *node)
 	{
+		names.emplace(node->GetName(), node);
+
 		Object *refobj = node->EvalWorldState(0).obj;
 
 		//if ((refobj->ClassID() == Class_ID(DUMMY_CLASS_ID, 0) || refobj->ClassID() == Class_ID(BONE_CLASS_ID, 0) || refobj->ClassID() == BONE_OBJ_CLASSID))
@@ -239,176 +452,311 @@ public:
 	}
 }iBoneScanner;
 
-INodeSuffixer ApexImp::LoadMesh(AmfMesh *imsh)
+// Meshes with equal content hash share a single TriObject for the import session.
+// Every occurrence gets its own node, modifiers and material.
+class MeshInstancer
 {
-	INodeSuffixer nde;
+	std::unordered_map<uint64_t, TriObject *> objects;
 
-	if (!imsh->IsValid())
-		return nde;
+public:
+	void Reset() { objects.clear(); }
 
-	TriObject *obj = CreateNewTriObject();
-	Mesh *msh = &obj->GetMesh();
+	TriObject *Find(const MeshStaging &staging) const
+	{
+		auto found = objects.find(staging.contentHash);
 
-	msh->setNumVerts(imsh->GetNumVertices());
-	msh->setNumFaces(imsh->GetNumIndices() / 3);
+		if (found == objects.end())
+			return nullptr;
 
-	const int numVerts = msh->numVerts;
-	const int numFaces = msh->numFaces;
-	const int numSubMeshes = imsh->GetNumSubMeshes();
-	int currentMap = 1;	
-	int matid = 0;
-	AmfMesh::DescriptorCollection decs = imsh->GetDescriptors();
+		// Cheap guard against hash collisions.
+		Mesh &msh = found->second->GetMesh();
 
-	for (auto &d : decs)
+		if (msh.getNumVerts() != staging.numVertices || msh.getNumFaces() != staging.numFaces)
+			return nullptr;
+
+		return found->second;
+	}
+
+	void Add(const MeshStaging &staging, TriObject *obj) { objects[staging.contentHash] = obj; }
+}iMeshInstancer;
+
+// User properties stamped on imported mesh nodes, hashes are hex strings.
+static const TCHAR apexSourceProp[] = _T("apexSource");
+static const TCHAR apexMeshProp[] = _T("apexMesh");
+static const TCHAR apexLODProp[] = _T("apexLOD");
+static const TCHAR apexCopyProp[] = _T("apexCopy");
+static const TCHAR apexGeometryProp[] = _T("apexGeometry");
+static const TCHAR apexDeformProp[] = _T("apexDeform");
+static const TCHAR apexMaterialProp[] = _T("apexMaterial");
+
+// Bounding box proxies, file is cleared once a proxy is expanded.
+static const TCHAR apexProxyFileProp[] = _T("apexProxyFile");
+static const TCHAR apexMeshIndexProp[] = _T("apexMeshIndex");
+static const TCHAR apexPivotXProp[] = _T("apexPivotX");
+static const TCHAR apexPivotYProp[] = _T("apexPivotY");
+static const TCHAR apexPivotZProp[] = _T("apexPivotZ");
+
+static MSTR HashProp(uint64_t hash)
+{
+	TCHAR buffer[24];
+	_stprintf_s(buffer, _T("%016llX"), static_cast<unsigned long long>(hash));
+
+	return buffer;
+}
+
+static uint64_t GetHashProp(INode *node, const TCHAR *key)
+{
+	MSTR value;
+
+	if (!node->GetUserPropString(key, value))
+		return 0;
+
+	return _tcstoui64(value.data(), nullptr, 16);
+}
+
+// File name without folders, archive entries keep only their own name.
+static MSTR SourceName(const TCHAR *filename)
+{
+	const TCHAR *name = filename;
+
+	for (const TCHAR *c = filename; *c; c++)
+		if (*c == '\\' || *c == '/' || *c == '|')
+			name = c + 1;
+
+	MSTR result = name;
+	result.toLower();
+
+	return result;
+}
+
+// Mesh identity within a source, copy counts meshes of the same name in one LOD.
+static uint64_t MeshNodeKey(uint64_t nameHash, int lodIndex, int copy)
+{
+	const uint64_t parts[] = { nameHash, static_cast<uint64_t>(lodIndex), static_cast<uint64_t>(copy) };
+
+	return HashBytes(parts, sizeof(parts), 0);
+}
+
+// Collects mesh nodes imported from a source earlier, matched nodes are taken out.
+// Whatever is left after re-import has no counterpart in the new file.
+static class : public ITreeEnumProc
+{
+	std::unordered_map<uint64_t, INode *> nodes;
+	MSTR source;
+
+public:
+	void Scan(const MSTR &sourceName)
 	{
-		switch (d->usage)
-		{
-		case AmfUsage_Position:
-		{
-			Matrix3 localCorMat = corMat;
-			float *packer = reinterpret_cast<float*>(d->packingData);
+		nodes.clear();
+		source = sourceName;
+		GetCOREInterface7()->GetScene()->EnumTree(this);
+	}
 
-			if (*packer > FLT_EPSILON)
-				localCorMat.Scale({ *packer,*packer,*packer });
+	INode *Take(uint64_t key)
+	{
+		auto found = nodes.find(key);
 
-			localCorMat.Scale({ IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value });
+		if (found == nodes.end())
+			return nullptr;
 
-			for (int v = 0; v < numVerts; v++)
-			{
-				Point3 tmp;
-				d->Evaluate(v, &tmp); 
-				msh->setVert(v, localCorMat.VectorTransform(tmp));
-			}
-			break;
-		}
-		case AmfUsage_Normal:
-		case AmfUsage_TangentSpace:
-		{
-			msh->SpecifyNormals();
-			MeshNormalSpec *normalSpec = msh->GetSpecifiedNormals();
-			normalSpec->ClearNormals();
-			normalSpec->SetNumNormals(numVerts);
-			normalSpec->SetNumFaces(numFaces);
-			nde.UseNormals();
+		INode *node = found->second;
+		nodes.erase(found);
 
-			for (int v = 0; v < numVerts; v++)
-			{
-				Point3 temp;
-				d->Evaluate(v, &temp);
-				normalSpec->Normal(v) = corMat.VectorTransform(temp);
-				normalSpec->SetNormalExplicit(v, true);
-			}
+		return node;
+	}
 
-			for (int s = 0; s < numSubMeshes; s++)
-			{
-				USVector *ibuff = reinterpret_cast<USVector *>(imsh->GetIndicesBuffer(s));
+	int NumLeft() const { return static_cast<int>(nodes.size()); }
 
-				for (int f = 0; f < numFaces; f++, ibuff++)
-				{
-					MeshNormalFace &normalFace = normalSpec->Face(f);
-					normalFace.SpecifyAll();
-					normalFace.SetNormalID(0, ibuff->X);
-					normalFace.SetNormalID(1, ibuff->Y);
-					normalFace.SetNormalID(2, ibuff->Z);
-				}
-			}
-			break;
-		}
-		case AmfUsage_TextureCoordinate:
-		{
-			msh->setMapSupport(currentMap, 1);
-			msh->setNumMapVerts(currentMap, numVerts);
-			msh->setNumMapFaces(currentMap, numFaces);
-			nde.AddChannel(currentMap);
-			Vector2 packer = *reinterpret_cast<Vector2*>(d->packingData);
+	void Reset() { nodes.clear(); }
 
-			if (!packer.Length())
-				packer = Vector2(1.0f, 1.0f);
+	int callback(INode *node)
+	{
+		MSTR nodeSource;
 
-			Matrix3 uvscale = {
-				Point3{ packer.X, 0.f, 0.f },
-				Point3{ 0.f, -packer.Y, 0.f },
-				Point3{ 0.f, 0.f, 1.f },
-				Point3{ 0.f, 1.f, 0.f }
-			};
-			for (int v = 0; v < numVerts; v++)
-			{
-				Vector2 temp;
-				d->Evaluate(v, &temp);
-				msh->Map(currentMap).tv[v] = uvscale.PointTransform({ temp.X, temp.Y, 0.f });
-			}
+		if (!node->GetUserPropString(apexSourceProp, nodeSource) || nodeSource != source)
+			return TREE_CONTINUE;
 
-			currentMap++;
-			break;
+		int lodIndex = 0, copy = 0;
+		node->GetUserPropInt(apexLODProp, lodIndex);
+		node->GetUserPropInt(apexCopyProp, copy);
+		nodes[MeshNodeKey(GetHashProp(node, apexMeshProp), lodIndex, copy)] = node;
+
+		return TREE_CONTINUE;
+	}
+}iNodeMatcher;
+
+// Swaps mesh under the modifier stack, or the whole object of a node without one.
+static void ReplaceBaseObject(INode *node, Object *obj)
+{
+	Object *ref = node->GetObjectRef();
+
+	if (ref && ref->SuperClassID() == GEN_DERIVOB_CLASS_ID)
+		static_cast<IDerivedObject *>(ref)->ReferenceObject(obj);
+	else
+		node->SetObjectRef(obj);
+}
+
+// Takes off skin and morph modifiers ApplyDeform has added, user modifiers stay.
+static void RemoveDeform(INode *node)
+{
+	Object *ref = node->GetObjectRef();
+
+	if (!ref || ref->SuperClassID() != GEN_DERIVOB_CLASS_ID)
+		return;
+
+	IDerivedObject *derived = static_cast<IDerivedObject *>(ref);
+
+	for (int m = derived->NumModifiers() - 1; m >= 0; m--)
+	{
+		const Class_ID modID = derived->GetModifier(m)->ClassID();
+
+		if (modID == SKIN_CLASSID || modID == MR3_CLASS_ID)
+			derived->DeleteModifier(m);
+	}
+}
+
+// Suffix flags of a mesh, must be filled before map faces are assigned.
+static void DescribeMesh(const MeshStaging &staging, INodeSuffixer &nde)
+{
+	if (staging.normals.size())
+		nde.UseNormals();
+
+	const int numChannels = static_cast<int>(staging.uvChannels.size());
+
+	for (int c = 0; c < numChannels; c++)
+		nde.AddChannel(c + 1);
+
+	if (staging.colors.size())
+	{
+		if (staging.alpha.size())
+			nde.AddFullColor();
+		else
+			nde.AddColor();
+	}
+}
+
+// Returns shared object when an equal mesh was already built during this import.
+TriObject *ApexImp::BuildMesh(MeshStaging &staging, INodeSuffixer &nde)
+{
+	static_assert(sizeof(Vector) == sizeof(Point3), "Staging vectors must match Point3");
+
+	ScopedPhase phase(ImportPhase_Mesh, staging.name.c_str());
+	DescribeMesh(staging, nde);
+
+	if (instanceMeshes)
+		if (TriObject *instance = iMeshInstancer.Find(staging))
+		{
+			importProfiler.Add(ImportCounter_Instances);
+			return instance;
 		}
-		case AmfUsage_Color:
-		{	
-			const bool colorOnly = d->format == AmfFormat_R32_UNIT_UNSIGNED_VEC_AS_FLOAT_c;
 
-			if (colorOnly)
-			{
-				msh->setMapSupport(0, 1);
-				msh->setNumMapVerts(0, numVerts);
-				nde.AddColor();
+	TriObject *obj = CreateNewTriObject();
+	Mesh *msh = &obj->GetMesh();
 
-				for (int v = 0; v < numVerts; v++)
-				{
-					Point3 temp;
-					d->Evaluate(v, &temp);
-					msh->Map(0).tv[v] = temp;
-				}
-			}
-			else
-			{
-				msh->setMapSupport(-2, 1);
-				msh->setNumMapVerts(-2, numVerts);
-				msh->setMapSupport(0, 1);
-				msh->setNumMapVerts(0, numVerts);
-				nde.AddFullColor();
+	const int numVerts = staging.numVertices;
+	const int numFaces = staging.numFaces;
 
-				for (int v = 0; v < numVerts; v++)
-				{
-					Vector4 temp;
-					d->Evaluate(v, &temp);
-					msh->Map(0).tv[v] = reinterpret_cast<Point3&>(temp);
-					msh->Map(-2).tv[v] = { temp.W, temp.W, temp.W };
-				}
-			}
-			break;
+	msh->setNumVerts(numVerts);
+	msh->setNumFaces(numFaces);
+
+	if (staging.positions.size())
+		memcpy(msh->verts, staging.positions.data(), numVerts * sizeof(Point3));
+
+	if (staging.normals.size())
+	{
+		msh->SpecifyNormals();
+		MeshNormalSpec *normalSpec = msh->GetSpecifiedNormals();
+		normalSpec->ClearNormals();
+		normalSpec->SetNumNormals(numVerts);
+		normalSpec->SetNumFaces(numFaces);
+
+		for (int v = 0; v < numVerts; v++)
+		{
+			normalSpec->Normal(v) = reinterpret_cast<const Point3 &>(staging.normals[v]);
+			normalSpec->SetNormalExplicit(v, true);
 		}
 
-		default:
-			break;
+		for (int f = 0; f < numFaces; f++)
+		{
+			const USVector &ibuff = staging.faces[f];
+			MeshNormalFace &normalFace = normalSpec->Face(f);
+			normalFace.SpecifyAll();
+			normalFace.SetNormalID(0, ibuff.X);
+			normalFace.SetNormalID(1, ibuff.Y);
+			normalFace.SetNormalID(2, ibuff.Z);
 		}
 	}
 
-	int currentFaceOffset = 0;
+	int currentMap = 1;
 
-	for (int s = 0; s < numSubMeshes; s++)
+	for (auto &channel : staging.uvChannels)
 	{
-		USVector *ibuff = reinterpret_cast<USVector *>(imsh->GetIndicesBuffer(s));
-		const int curNumFaces = imsh->GetNumIndices(s)/ 3;
+		msh->setMapSupport(currentMap, 1);
+		msh->setNumMapVerts(currentMap, numVerts);
+		msh->setNumMapFaces(currentMap, numFaces);
+		memcpy(msh->Map(currentMap).tv, channel.data(), numVerts * sizeof(UVVert));
+		currentMap++;
+	}
+
+	if (staging.colors.size())
+	{
+		msh->setMapSupport(0, 1);
+		msh->setNumMapVerts(0, numVerts);
+		memcpy(msh->Map(0).tv, staging.colors.data(), numVerts * sizeof(UVVert));
+
+		if (staging.alpha.size())
+		{
+			msh->setMapSupport(-2, 1);
+			msh->setNumMapVerts(-2, numVerts);
+
+			for (int v = 0; v < numVerts; v++)
+			{
+				const float alpha = staging.alpha[v];
+				msh->Map(-2).tv[v] = { alpha, alpha, alpha };
+			}
+		}
+	}
+
+	int currentFace = 0;
+	int matid = 0;
 
-		for (int f = 0; f < curNumFaces; f++, ibuff++)
+	for (int numSubFaces : staging.subMeshNumFaces)
+	{
+		for (int f = 0; f < numSubFaces; f++, currentFace++)
 		{
-			Face &face = msh->faces[currentFaceOffset + f];
+			const USVector &ibuff = staging.faces[currentFace];
+			Face &face = msh->faces[currentFace];
 			face.setEdgeVisFlags(1, 1, 1);
-			face.v[0] = ibuff->X;
-			face.v[1] = ibuff->Y;
-			face.v[2] = ibuff->Z;
+			face.v[0] = ibuff.X;
+			face.v[1] = ibuff.Y;
+			face.v[2] = ibuff.Z;
 			face.setMatID(matid);
 
 			for (int &i : nde)
-				msh->Map(i).tf[currentFaceOffset + f].setTVerts(ibuff->X, ibuff->Y, ibuff->Z);
+				msh->Map(i).tf[currentFace].setTVerts(ibuff.X, ibuff.Y, ibuff.Z);
 		}
 
-		currentFaceOffset += curNumFaces;
 		matid++;
 	}
 
 	msh->InvalidateGeomCache();
 	msh->InvalidateTopologyCache();
-	nde.node = GetCOREInterface()->CreateObjectNode(obj);
+
+	if (instanceMeshes)
+		iMeshInstancer.Add(staging, obj);
+
+	return obj;
+}
+
+INodeSuffixer ApexImp::LoadMesh(MeshStaging &staging)
+{
+	INodeSuffixer nde;
+
+	if (!staging.Valid())
+		return nde;
+
+	nde.node = CreateSceneNode(BuildMesh(staging, nde));
+
 	return nde;
 }
 
@@ -432,7 +780,7 @@ void ApexImp::LoadSpriteData(AmfMesh *mesh, INode *nde)
 	for (int curBone = 0; curBone < numNodes; curBone++)
 	{
 		Object *obj = static_cast<Object*>(CreateInstance(HELPER_CLASS_ID, Class_ID(DUMMY_CLASS_ID, 0)));
-		INode *node = GetCOREInterface()->CreateObjectNode(obj);
+		INode *node = CreateSceneNode(obj);
 		node->ShowBone(2);
 		Matrix3 localCorMat = corMat;
 		localCorMat.Scale({ IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value });
@@ -440,6 +788,7 @@ void ApexImp::LoadSpriteData(AmfMesh *mesh, INode *nde)
 		node->SetNodeTM(0, localCorMat);
 		node->SetWireColor(0x80ff);
 		node->SetName(ToBoneName((TSTRING(_T("SpriteBone")) + ToTSTRING(curBone))));
+		importProfiler.Add(ImportCounter_Bones);
 
 		if (cskin)
 		{
@@ -485,33 +834,16 @@ void ApexImp::LoadSpriteData(AmfMesh *mesh, INode *nde)
 	}
 }
 
-void LoadDeform(AmfMesh *mesh, INode *nde)
+void LoadDeform(const MeshStaging &staging, INode *nde)
 {
-	AmfVertexDescriptor *deform = nullptr,
-		*points = nullptr;
-
-	AmfMesh::DescriptorCollection decs = mesh->GetDescriptors();
-
-	for (auto &d : decs)
-	{
-		switch (d->usage)
-		{
-		case AmfUsage_DeformNormal_c:
-			deform = d.get();
-			break;
-		case AmfUsage_DeformPoints_c:
-			points = d.get();
-			break;
-		}
-	}
-
+	const MorphStaging &morph = staging.morph;
 	Modifier *cmod = (Modifier*)GetCOREInterface()->CreateInstance(OSM_CLASS_ID, MR3_CLASS_ID);
 	GetCOREInterface7()->AddModifier(*nde, *cmod);
 
 	MaxMorphModifier morpher = {};
 	morpher.Init(cmod);
 	
-	const int numVerts = mesh->GetNumVertices();
+	const int numVerts = staging.numVertices;
 
 	{
 		MaxMorphChannel chan = morpher.GetMorphChannel(0);
@@ -519,21 +851,16 @@ void LoadDeform(AmfMesh *mesh, INode *nde)
 		chan.SetName(_T("Deform"));
 
 		for (int v = 0; v < numVerts; v++)
-		{
-			Point3 temp;
-			deform->Evaluate(v, &temp);
-
-			chan.SetMorphPointDelta(v, corMat.VectorTransform(temp) * 2.0f);
-		}
+			chan.SetMorphPointDelta(v, reinterpret_cast<const Point3 &>(morph.deltas[v]));
 	}
 
-	if (points)
+	if (morph.controlChannels.size())
 	{
-		const int numChannels = mesh->GetNumRemaps();
+		const int numChannels = static_cast<int>(staging.remaps.size());
 
 		for (int c = 0; c < numChannels; c++)
 		{
-			const int rmap = mesh->GetRemap(c);
+			const int rmap = staging.remaps[c];
 
 			if (rmap > 0)
 			{
@@ -545,224 +872,362 @@ void LoadDeform(AmfMesh *mesh, INode *nde)
 
 		for (int v = 0; v < numVerts; v++)
 		{
-			Point3 temp;
-			deform->Evaluate(v, &temp);
-
-			Vector4 cpoints;
-			points->Evaluate(v, &cpoints);
-
-			Vector4 indicies = cpoints.Convert<float>() * 127.996f;
-			Vector4 indiciesFloored(floorf(indicies.X), floorf(indicies.Y), floorf(indicies.Z), floorf(indicies.W));
-			UIVector4 indiciesOut = indiciesFloored.Convert<uint>() + 128;
-
-			Vector4 weights = indicies - indiciesFloored;
+			const Point3 &delta = reinterpret_cast<const Point3 &>(morph.deltas[v]);
+			const UIVector4 &channels = morph.controlChannels[v];
+			const Vector4 &weights = morph.controlWeights[v];
 
 			for (int c = 0; c < 4; c++)
 			{
-				MaxMorphChannel chan = morpher.GetMorphChannel(indiciesOut[c] + 1);
-				chan.SetMorphPointDelta(v, corMat.VectorTransform(temp) * 2.0f * weights[c]);
+				MaxMorphChannel chan = morpher.GetMorphChannel(channels[c] + 1);
+				chan.SetMorphPointDelta(v, delta * weights[c]);
 			}
 		}
 	}
 }
 
-void LoadSkin(AmfMesh *mesh, INode *nde)
+void LoadSkin(const MeshStaging &staging, INode *nde)
 {
-	INodeTab bones;
-	const int numVerts = mesh->GetNumVertices();
-	AmfMesh::DescriptorCollection decs = mesh->GetDescriptors();
-	std::vector<AmfVertexDescriptor *> weights;
-	std::vector<AmfVertexDescriptor *> bonesids;
-
-	for (auto &d : decs)
-	{
-		switch (d->usage)
-		{
-		case AmfUsage_BoneIndex:
-			bonesids.push_back(d.get());
-			break;
-		case AmfUsage_BoneWeight:
-			weights.push_back(d.get());
-			break;
-		}
-	}
+	const SkinStaging &skin = staging.skin;
 
-	if (!bonesids.size())
+	if (!skin.Valid())
 		return;
 
 	Modifier *cmod = static_cast<Modifier*>(GetCOREInterface()->CreateInstance(OSM_CLASS_ID, SKIN_CLASSID));
 	GetCOREInterface7()->AddModifier(*nde, *cmod);
 	ISkinImportData *cskin = static_cast<ISkinImportData*>(cmod->GetInterface(I_SKINIMPORTDATA));
 
-	const int numRemaps = mesh->GetNumRemaps();
+	INodeTab bones;
 
-	for (int c = 0; c < numRemaps; c++)
+	for (int b : staging.remaps)
 	{
-		INode *cnde = iBoneScanner.LookupNode(mesh->GetRemap(c));
+		INode *cnde = iBoneScanner.LookupNode(b);
 		bones.AppendNode(cnde);
 		cskin->AddBoneEx(cnde, 0);
 	}
 
-	nde->EvalWorldState(0);	
-
-	if (!weights.size())
-	{
-		AmfVertexDescriptor &cbns = *bonesids[0];
-
-		for (int v = 0; v < numVerts; v++)
-		{
-			uchar temp;
-			cbns.Evaluate(v, &temp);
+	nde->EvalWorldState(0);
 
-			Tab<INode*> cbn;
-			Tab<float> cwt;
-			cbn.SetCount(1);
-			cwt.SetCount(1);
-			cbn[0] = bones[temp];
-			cwt[0] = 1.0f;
+	const int numVerts = staging.numVertices;
+	const int numInfluences = skin.numInfluences;
+	Tab<INode*> cbn;
+	Tab<float> cwt;
+	cbn.SetCount(numInfluences);
+	cwt.SetCount(numInfluences);
 
-			cskin->AddWeights(nde, v, cbn, cwt);
-		}
-	}
-	else if (weights.size() == 1)
+	for (int v = 0; v < numVerts; v++)
 	{
-		AmfVertexDescriptor &cbns = *bonesids[0];
-		AmfVertexDescriptor &cwts = *weights[0];
-
-		for (int v = 0; v < numVerts; v++)
+		for (int i = 0; i < numInfluences; i++)
 		{
-			UCVector4 bns;
-			cbns.Evaluate(v, &bns);
+			cbn[i] = bones[skin.indices[v * numInfluences + i]];
+			cwt[i] = skin.weights[v * numInfluences + i];
+		}
 
-			Vector4 wts;
-			cwts.Evaluate(v, &wts);
+		cskin->AddWeights(nde, v, cbn, cwt);
+	}
+}
 
-			Tab<INode*> cbn;
-			Tab<float> cwt;
-			cbn.SetCount(4);
-			cwt.SetCount(4);
-			
-			cbn[0] = bones[bns.X];
-			cwt[0] = wts.X;
-			cbn[1] = bones[bns.Y];
-			cwt[1] = wts.Y;
-			cbn[2] = bones[bns.Z];
-			cwt[2] = wts.Z;
-			cbn[3] = bones[bns.W];
-			cwt[3] = wts.W;
+void ApexImp::ApplyDeform(const MeshStaging &staging, INodeSuffixer &nde)
+{
+	ScopedPhase phase(ImportPhase_Deform, staging.name.c_str());
+	const int numRemaps = static_cast<int>(staging.remaps.size());
 
-			cskin->AddWeights(nde, v, cbn, cwt);
-		}
-	}
-	else
+	if (staging.spriteRemap)
 	{
-		for (int v = 0; v < numVerts; v++)
-		{
-			Tab<INode*> cbn;
-			Tab<float> cwt;
-			cbn.SetCount(8);
-			cwt.SetCount(8);
+		LoadSpriteData(staging.source.get(), nde);
 
-			for (int d = 0; d < bonesids.size(); d++)
-			{
-				UCVector4 bns;
-				bonesids[d]->Evaluate(v, &bns);
+		if (numRemaps > 1)
+			nde.UseSkin();
+
+		return;
+	}	
+
+	if (staging.morph.Valid())
+	{
+		LoadDeform(staging, nde);
+		nde.UseMorph();
+		return;
+	}
+
+	if (numRemaps > 1)
+	{
+		LoadSkin(staging, nde);
+		nde.UseSkin();
+	}
+	else if (numRemaps > 0)
+	{
+		INode *cnde = iBoneScanner.LookupNode(staging.remaps[0]);
+
+		if (cnde)
+			cnde->AttachChild(nde);
+	}
+}
 
-				Vector4 wts;
-				weights[d]->Evaluate(v, &wts);
+// Expects suffix flags set by DescribeMesh and ApplyDeform.
+void ApexImp::NameNode(const MeshStaging &staging, INodeSuffixer &nde)
+{
+	TSTRING ndeName = static_cast<TSTRING>(esString(staging.name.c_str()));
+
+	if (flags[IDC_CH_DEBUGNAME_checked])
+	{
+		TSTRING className = static_cast<TSTRING>(esString(staging.source->GetMeshType()));
+		ndeName.append(nde.Generate(&className));
+	}
+
+	nde.node->SetName(ToBoneName(ndeName));
+}
+
+
+class MaterialDump
+{
+	std::string buffer;
+	int numMaterials = 0;
+	int numAttributes = 0;
+
+	void AppendEscaped(const char *str)
+	{
+		buffer.push_back('"');
 
-				for (int s = 0; s < 4; s++)
+		for (; *str; str++)
+		{
+			const char c = *str;
+
+			switch (c)
+			{
+			case '"':
+				buffer.append("\\\"");
+				break;
+			case '\\':
+				buffer.append("\\\\");
+				break;
+			case '\n':
+				buffer.append("\\n");
+				break;
+			case '\t':
+				buffer.append("\\t");
+				break;
+			default:
+				if (static_cast<uchar>(c) < 0x20)
 				{
-					cbn[s + d * 4] = bones[bns[s]];
-					cwt[s + d * 4] = wts[s];
+					char hex[8];
+					snprintf(hex, sizeof(hex), "\\u%04x", c);
+					buffer.append(hex);
 				}
+				else
+					buffer.push_back(c);
+				break;
 			}
+		}
+
+		buffer.push_back('"');
+	}
+
+	void AppendHash(ApexHash hash)
+	{
+		char hex[16];
+		snprintf(hex, sizeof(hex), "\"%08X\"", hash);
+		buffer.append(hex);
+	}
+
+public:
+	void Reset()
+	{
+		buffer.clear();
+		buffer.append("{\n\t\"materials\": [");
+		numMaterials = 0;
+		numAttributes = 0;
+	}
 
-			cskin->AddWeights(nde, v, cbn, cwt);
+	void Add(const MaterialStaging &mat)
+	{
+		const int numReflValues = static_cast<int>(mat.attributes.size());
+
+		buffer.append(numMaterials ? ",\n\t\t{\n\t\t\t\"name\": " : "\n\t\t{\n\t\t\t\"name\": ");
+		AppendEscaped(mat.name.c_str());
+		buffer.append(",\n\t\t\t\"nameHash\": ");
+		AppendHash(mat.nameHash);
+		buffer.append(",\n\t\t\t\"attributesHash\": ");
+		AppendHash(mat.attributesHash);
+		buffer.append(",\n\t\t\t\"attributes\": {");
+
+		for (int t = 0; t < numReflValues; t++)
+		{
+			buffer.append(t ? ",\n\t\t\t\t" : "\n\t\t\t\t");
+			AppendEscaped(mat.attributes[t].first.c_str());
+			buffer.append(": ");
+			AppendEscaped(mat.attributes[t].second.c_str());
 		}
+
+		buffer.append(numReflValues ? "\n\t\t\t}\n\t\t}" : "}\n\t\t}");
+		numMaterials++;
+		numAttributes += numReflValues;
+	}
+
+	bool Save(const TSTRING &path)
+	{
+		buffer.append(numMaterials ? "\n\t]\n}\n" : "]\n}\n");
+
+		FILE *fle = _tfopen(path.c_str(), _T("wb"));
+
+		if (!fle)
+			return false;
+
+		const bool written = fwrite(buffer.data(), 1, buffer.size(), fle) == buffer.size();
+		fclose(fle);
+
+		return written;
 	}
 
+	int NumMaterials() const { return numMaterials; }
+	int NumAttributes() const { return numAttributes; }
+}iMaterialDump;
+
+static uint64_t FingerprintMaterial(const MaterialStaging &mat)
+{
+	const uint32_t header[] = { mat.nameHash, mat.attributesHash, mat.pbr };
+	uint64_t hash = HashBytes(header, sizeof(header), 0);
+
+	for (auto &t : mat.textures)
+		hash = HashBytes(t.data(), t.size(), hash);
+
+	return hash;
 }
 
-void ApexImp::ApplyDeform(AmfMesh *mesh, INodeSuffixer &nde)
+// Materials of one staged model, created on first use.
+// Re-import and proxy expansion don't build materials of nodes they leave alone.
+class ModelMaterials
 {
-	const int numRemaps = mesh->GetNumRemaps();
-	AmfMesh::DescriptorCollection decs = mesh->GetDescriptors();
+	std::map<ApexHash, const MaterialStaging *> staged;
+	std::map<ApexHash, uint64_t> hashes;
+	std::map<ApexHash, Mtl *> created;
+	bool enabled;
+	bool forceStandard;
+	bool viewportMaps;
 
-	if (mesh->GetRemapType() == REMAP_TYPE_SPRITE)
+public:
+	ModelMaterials(const ModelStaging &staging, bool enabled, bool forceStandard, bool viewportMaps) :
+		enabled(enabled), forceStandard(forceStandard), viewportMaps(viewportMaps)
 	{
-		LoadSpriteData(mesh, nde);
+		for (auto &smat : staging.materials)
+		{
+			staged[smat.nameHash] = &smat;
+			hashes[smat.nameHash] = FingerprintMaterial(smat);
+		}
+	}
 
-		if (numRemaps > 1)
-			nde.UseSkin();
+	Mtl *Get(ApexHash hash)
+	{
+		auto found = created.find(hash);
 
-		goto _ApplyDeformNameNode;
-	}	
+		if (found != created.end())
+			return found->second;
 
-	for (auto &d : decs)
-		if (d->usage == AmfUsage_DeformNormal_c)
+		auto smat = staged.find(hash);
+		Mtl *cMat = nullptr;
+
+		if (enabled && smat != staged.end())
 		{
-			LoadDeform(mesh, nde);
-			nde.UseMorph();
-			goto _ApplyDeformNameNode;
+			cMat = CreateMaterial(smat->second->source.get(), forceStandard, iArchives.Empty() ? nullptr : &iArchives);
+
+			if (viewportMaps)
+				GetCOREInterface()->ActivateTexture(cMat, cMat);
 		}
 
-	if (numRemaps > 1)
-	{
-		LoadSkin(mesh, nde);
-		nde.UseSkin();
+		created[hash] = cMat;
+
+		return cMat;
 	}
-	else if (numRemaps > 0)
+
+	void Assign(INode *node, const MeshStaging &mesh)
 	{
-		INode *cnde = iBoneScanner.LookupNode(mesh->GetRemap(0));
+		const int numSubMeshes = static_cast<int>(mesh.subMeshNameHashes.size());
 
-		if (cnde)
-			cnde->AttachChild(nde);
-	}
+		if (numSubMeshes > 1)
+		{
+			MultiMtl *mtl = NewDefaultMultiMtl();
+			mtl->SetNumSubMtls(numSubMeshes);
 
-_ApplyDeformNameNode:
-	TSTRING ndeName = static_cast<TSTRING>(esString(mesh->GetSubMeshName(0)));
+			for (int s = 0; s < numSubMeshes; s++)
+				if (Mtl *subMtl = Get(mesh.subMeshNameHashes[s]))
+				{
+					mtl->SetSubMtl(s, subMtl);
+				}
 
-	if (flags[IDC_CH_DEBUGNAME_checked])
+			node->SetMtl(mtl);
+		}
+		else
+			node->SetMtl(numSubMeshes ? Get(mesh.subMeshNameHashes[0]) : nullptr);
+	}
+
+	// Changes with any material of the mesh or with settings materials are built with.
+	uint64_t MeshHash(const MeshStaging &mesh) const
 	{
-		TSTRING className = static_cast<TSTRING>(esString(mesh->GetMeshType()));
-		ndeName.append(nde.Generate(&className));
+		const int settings[] = { enabled, forceStandard };
+		uint64_t hash = HashBytes(settings, sizeof(settings), 0);
+
+		for (ApexHash h : mesh.subMeshNameHashes)
+		{
+			auto found = hashes.find(h);
+			const uint64_t matHash = found == hashes.end() ? 0 : found->second;
+			hash = HashBytes(&matHash, sizeof(matHash), hash);
+		}
+
+		return hash;
 	}
+};
 
-	nde.node->SetName(ToBoneName(ndeName));
+static uint64_t MeshNameHash(const MeshStaging &mesh)
+{
+	return HashBytes(mesh.name.data(), mesh.name.size(), 0);
 }
 
+static void StampNode(INode *node, const MSTR &source, uint64_t nameHash, int lodIndex, int copy, const MeshStaging &staging, uint64_t materialHash)
+{
+	node->SetUserPropString(apexSourceProp, source);
+	node->SetUserPropString(apexMeshProp, HashProp(nameHash));
+	node->SetUserPropInt(apexLODProp, lodIndex);
+	node->SetUserPropInt(apexCopyProp, copy);
+	node->SetUserPropString(apexGeometryProp, HashProp(staging.contentHash));
+	node->SetUserPropString(apexDeformProp, HashProp(staging.deformHash));
+	node->SetUserPropString(apexMaterialProp, HashProp(materialHash));
+}
 
-void DumpMaterialProps(AmfMaterial *mat)
+static ILayer *LODLayer(int lodIndex)
 {
-	ReflectorPtr attributtes = mat->GetReflectedAttributes();
+	ILayerManager *manager = GetCOREInterface13()->GetLayerManager();
+	MSTR layName = _T("LOD");
+	layName.append(ToTSTRING(lodIndex).c_str());
 
-	if (!attributtes)
-		return;
-	
-	const int numReflValues = attributtes->GetNumReflectedValues();
+	ILayer *layer = manager->GetLayer(layName);
 
-	if (!numReflValues)
-		return;
+	if (!layer)
+		layer = manager->CreateLayer(layName);
+
+	return layer;
+}
 
-	printer << mat->GetName() << " attributes: " >> 1;
+// Re-import of a matched node, deform is always rebuilt with geometry as skin weights are per vertex.
+void ApexImp::RebuildNode(INode *node, MeshStaging &staging, bool geometry)
+{
+	INodeSuffixer nde;
 
-	for (int t = 0; t < numReflValues; t++)
-	{
-		const Reflector::KVPair &pair = attributtes->GetReflectedPair(t);
+	if (geometry)
+		ReplaceBaseObject(node, BuildMesh(staging, nde));
+	else
+		DescribeMesh(staging, nde);
 
-		printer << '\t' << pair.name << " = " << pair.value.c_str() >> 1;
-	}
+	RemoveDeform(node);
+	nde.node = node;
+	ApplyDeform(staging, nde);
 }
 
-int ApexImp::LoadModel(IADF *adf)
+int ApexImp::LoadModel(ModelStaging &staging, const TCHAR *filename)
 {
-	AmfMeshHeader *msh = adf->FindInstance<AmfMeshHeader>();
-	AmfModel *mod = adf->FindInstance<AmfModel>();
-
-	if (!msh || !mod)
+	if (!staging.header || !staging.model)
 		return FALSE;
 
+	if (flags[IDC_CH_PROXY_checked])
+		return LoadProxies(staging, filename);
+
 	IColorVar *_test = IColorVar::Create();
 
 	if (!_test)
@@ -770,139 +1235,496 @@ int ApexImp::LoadModel(IADF *adf)
 		printwarning("Xplorer not loaded, materials won't be created for Apex Tool import.")
 	}
 
-	ILayerManager* manager = GetCOREInterface13()->GetLayerManager();
-	std::map<ApexHash, Mtl*> materials;
+	ModelMaterials materials(staging, _test != nullptr, flags[IDC_CH_FORCESTDMAT_checked], flags[IDC_CH_ENABLEVIEWMAT_checked]);
+
+	if (_test && flags[IDC_CH_DUMPMATINFO_checked])
+		for (auto &smat : staging.materials)
+			iMaterialDump.Add(smat);
+
+	const bool reimport = flags[IDC_CH_REIMPORT_checked];
+	const MSTR sourceName = SourceName(filename);
+	int numUpdated = 0;
+	int numKept = 0;
+
+	if (reimport)
+		iNodeMatcher.Scan(sourceName);
 
-	if (_test)
+	for (auto &lod : staging.lods)
 	{
-		const int numMaterials = mod->GetNumMaterials();
+		ScopedTrace lodTrace("lodGroup", std::string("LOD") + std::to_string(lod.lodIndex));
+		ILayer *currLayer = LODLayer(lod.lodIndex);
+		std::unordered_map<uint64_t, int> copies;
 
-		for (int m = 0; m < numMaterials; m++)
+		for (auto &mesh : lod.meshes)
 		{
-			AmfMaterial::Ptr cmat = mod->GetMaterial(m);
+			const uint64_t nameHash = MeshNameHash(mesh);
+			const int copy = copies[nameHash]++;
+			const uint64_t materialHash = materials.MeshHash(mesh);
+			INode *node = reimport ? iNodeMatcher.Take(MeshNodeKey(nameHash, lod.lodIndex, copy)) : nullptr;
 
-			bool forced = cmat->GetMaterialType() == MaterialType_PBR && flags[IDC_CH_FORCESTDMAT_checked];
+			// Nodes of culled meshes are out of region, not missing.
+			if (mesh.culled)
+				continue;
 
-			if (forced)
-				cmat->MaterialType() = MaterialType_Traditional;
+			if (node && mesh.Valid())
+			{
+				const bool geometryChanged = GetHashProp(node, apexGeometryProp) != mesh.contentHash;
+				const bool deformChanged = geometryChanged || GetHashProp(node, apexDeformProp) != mesh.deformHash;
+				const bool materialChanged = GetHashProp(node, apexMaterialProp) != materialHash;
 
-			Mtl *cMat = CreateMaterial(cmat.get());
+				if (!deformChanged && !materialChanged)
+				{
+					numKept++;
+					continue;
+				}
 
-			if (flags[IDC_CH_ENABLEVIEWMAT_checked])
-				GetCOREInterface()->ActivateTexture(cMat, cMat);
+				if (deformChanged)
+					RebuildNode(node, mesh, geometryChanged);
 
-			materials[cmat->GetNameHash()] = cMat;
+				if (materialChanged)
+					materials.Assign(node, mesh);
 
-			if (flags[IDC_CH_DUMPMATINFO_checked])
-				DumpMaterialProps(cmat.get());
+				StampNode(node, sourceName, nameHash, lod.lodIndex, copy, mesh, materialHash);
+				BulkCommit::Track(node);
+				numUpdated++;
+				continue;
+			}
+
+			INodeSuffixer nde = LoadMesh(mesh);
+
+			if (!nde.node)
+			{
+				printerror("[Apex] Couldn't import model: ", << mesh.name.c_str() << " LOD: " << lod.lodIndex);
+				continue;
+			}
 
-			if (forced)
-				cmat->MaterialType() = MaterialType_PBR;
+			materials.Assign(nde.node, mesh);
+			ApplyDeform(mesh, nde);
+			NameNode(mesh, nde);
+			StampNode(nde.node, sourceName, nameHash, lod.lodIndex, copy, mesh, materialHash);
+			currLayer->AddToLayer(nde);
 		}
 	}
 
-	const int numLODGroups = msh->GetNumLODs();
-
-	for (int ld = 0; ld < numLODGroups; ld++)
+	if (reimport)
 	{
-		MSTR layName = _T("LOD");
-		layName.append(ToTSTRING(msh->GetLodIndex(ld)).c_str());
+		printer << "[Apex] Re-import updated " << numUpdated << ", kept " << numKept << " node(s) of: " << sourceName.data() >> 1;
 
-		ILayer *currLayer = manager->GetLayer(layName);
+		if (iNodeMatcher.NumLeft())
+		{
+			printwarning("[Apex] Nodes missing in re-imported file were left in scene: ", << iNodeMatcher.NumLeft())
+		}
 
-		if (!currLayer)
-			currLayer = manager->CreateLayer(layName);
+		iNodeMatcher.Reset();
+	}
+
+	importProfiler.Add(ImportCounter_NodesUpdated, numUpdated);
+	importProfiler.Add(ImportCounter_NodesKept, numKept);
+
+	return TRUE;
+}
 
-		const int numLodMeshes = msh->GetNumLODMeshes(ld);
+// Box per mesh, pivot sits in the middle of the bottom face like on a box created by hand.
+int ApexImp::LoadProxies(ModelStaging &staging, const TCHAR *filename)
+{
+	for (auto &lod : staging.lods)
+	{
+		ILayer *currLayer = LODLayer(lod.lodIndex);
+		const int numMeshes = static_cast<int>(lod.meshes.size());
 
-		for (int m = 0; m < numLodMeshes; m++)
+		for (int m = 0; m < numMeshes; m++)
 		{
-			AmfMesh::Ptr cmsh = msh->GetLODMesh(ld, m);
-			INodeSuffixer nde = LoadMesh(cmsh.get());
+			const MeshStaging &mesh = lod.meshes[m];
 
-			if (!nde.node)
-			{
-				printerror("[Apex] Couldn't import model: ", << cmsh->GetSubMeshName(0) << " LOD: " << msh->GetLodIndex(ld));
+			// Meshes without position stream have empty bounds.
+			if (!mesh.Valid() || mesh.boundsMin.X > mesh.boundsMax.X)
 				continue;
-			}
 
-			const int numSubMeshes = cmsh->GetNumSubMeshes();
+			const Point3 &bmin = reinterpret_cast<const Point3 &>(mesh.boundsMin);
+			const Point3 &bmax = reinterpret_cast<const Point3 &>(mesh.boundsMax);
+			const Point3 extents = bmax - bmin;
+			const Point3 pivot((bmin.x + bmax.x) * 0.5f, (bmin.y + bmax.y) * 0.5f, bmin.z);
+
+			GenBoxObject *box = static_cast<GenBoxObject *>(CreateInstance(GEOMOBJECT_CLASS_ID, Class_ID(BOXOBJ_CLASS_ID, 0)));
+			box->SetParams(extents.x, extents.z, extents.y);
+
+			INode *node = CreateSceneNode(box);
+			node->SetNodeTM(0, TransMatrix(pivot));
+			node->SetWireColor(0x808080);
+			node->SetName(ToBoneName(static_cast<TSTRING>(esString(mesh.name.c_str()))));
+			node->SetUserPropString(apexProxyFileProp, filename);
+			node->SetUserPropInt(apexLODProp, lod.lodIndex);
+			node->SetUserPropInt(apexMeshIndexProp, m);
+			node->SetUserPropFloat(apexPivotXProp, pivot.x);
+			node->SetUserPropFloat(apexPivotYProp, pivot.y);
+			node->SetUserPropFloat(apexPivotZProp, pivot.z);
+			currLayer->AddToLayer(node);
+			importProfiler.Add(ImportCounter_Proxies);
+		}
+	}
 
-			if (numSubMeshes > 1)
-			{
-				MultiMtl *mtl = NewDefaultMultiMtl();
-				mtl->SetNumSubMtls(numSubMeshes);
+	return TRUE;
+}
 
-				for (int s = 0; s < numSubMeshes; s++)
-					if (materials.count(cmsh->GetSubMeshNameHash(s)))
-					{
-						mtl->SetSubMtl(s, materials[cmsh->GetSubMeshNameHash(s)]);
-					}
+// Proxy keeps its node, only the box under modifier stack is swapped.
+// Placement done on proxy is carried over, deform is left for re-import as skin would pull the mesh back to its bones.
+bool ApexImp::ExpandProxy(INode *node, ModelStaging &staging, ModelMaterials &materials, const TCHAR *filename)
+{
+	int lodIndex = 0, meshIndex = -1;
+	Point3 pivot(0.0f, 0.0f, 0.0f);
+	node->GetUserPropInt(apexLODProp, lodIndex);
+	node->GetUserPropInt(apexMeshIndexProp, meshIndex);
+	node->GetUserPropFloat(apexPivotXProp, pivot.x);
+	node->GetUserPropFloat(apexPivotYProp, pivot.y);
+	node->GetUserPropFloat(apexPivotZProp, pivot.z);
+
+	for (auto &lod : staging.lods)
+	{
+		if (lod.lodIndex != lodIndex || meshIndex < 0 || meshIndex >= static_cast<int>(lod.meshes.size()))
+			continue;
+
+		MeshStaging &mesh = lod.meshes[meshIndex];
+
+		if (!mesh.Valid())
+			break;
+
+		const uint64_t nameHash = MeshNameHash(mesh);
+		int copy = 0;
+
+		for (int m = 0; m < meshIndex; m++)
+			copy += MeshNameHash(lod.meshes[m]) == nameHash;
+
+		INodeSuffixer nde;
+		ReplaceBaseObject(node, BuildMesh(mesh, nde));
+		node->SetNodeTM(0, TransMatrix(-pivot) * node->GetNodeTM(0));
+		materials.Assign(node, mesh);
+
+		StampNode(node, SourceName(filename), nameHash, lodIndex, copy, mesh, materials.MeshHash(mesh));
+		node->SetUserPropString(apexDeformProp, HashProp(0));
+		node->SetUserPropString(apexProxyFileProp, _T(""));
+		BulkCommit::Track(node);
+
+		return true;
+	}
+
+	printerror("[Apex] Couldn't find proxy mesh: ", << node->GetName() << " LOD: " << lodIndex);
+
+	return false;
+}
 
-				nde.node->SetMtl(mtl);
+int ApexImp::ExpandProxies()
+{
+	char *oldLocale = setlocale(LC_NUMERIC, NULL);
+	setlocale(LC_NUMERIC, "en-US");
+
+	LoadCFG();
+	BeginImport();
+
+	Interface *ip = GetCOREInterface();
+	const int numSelected = ip->GetSelNodeCount();
+	std::map<TSTRING, std::vector<INode *>> proxies;
+
+	for (int n = 0; n < numSelected; n++)
+	{
+		INode *node = ip->GetSelNode(n);
+		MSTR file;
+
+		if (node->GetUserPropString(apexProxyFileProp, file) && file.Length())
+			proxies[file.data()].push_back(node);
+	}
+
+	StagingSettings settings = ImportSettings();
+	settings.lodFilter = LODFilter();
+	settings.region = StagingRegion();
+	settings.boundsOnly = false;
+
+	IColorVar *_test = IColorVar::Create();
+	int numExpanded = 0;
+
+	{
+		ScopedPhase phase(ImportPhase_Total);
+
+		for (auto &p : proxies)
+		{
+			const TCHAR *filename = p.first.c_str();
+			ImportSource source;
+			ModelStaging staging;
+
+			if (!ResolveSource(filename, source) || !StageFile(source, staging, settings) || !staging.model)
+			{
+				printerror("[Apex] Couldn't expand proxies of: ", << filename);
+				continue;
 			}
-			else if (materials.count(cmsh->GetSubMeshNameHash(0)))
-				nde.node->SetMtl(materials[cmsh->GetSubMeshNameHash(0)]);
 
-			ApplyDeform(cmsh.get(), nde);
-			currLayer->AddToLayer(nde);
+			ScopedPhase commitPhase(ImportPhase_Commit);
+			std::unique_ptr<BulkCommit> bulk(bulkCommit ? new BulkCommit : nullptr);
+			ModelMaterials materials(staging, _test != nullptr, flags[IDC_CH_FORCESTDMAT_checked], flags[IDC_CH_ENABLEVIEWMAT_checked]);
+
+			for (INode *node : p.second)
+				numExpanded += ExpandProxy(node, staging, materials, filename);
 		}
 	}
 
-	return TRUE;
+	printer << "[Apex] Expanded " << numExpanded << " of " << numSelected << " selected node(s)." >> 1;
+
+	setlocale(LC_NUMERIC, oldLocale);
+	EndImport();
+
+	return numExpanded;
 }
 
-int ApexImp::LoadStuntArea(IADF *adf)
+// Areas are already in Max space, vertices and indices are copied as whole blocks.
+// Merged areas become an Editable Mesh with a named face selection set per area,
+// their index within parent group is also kept as material ID.
+int ApexImp::LoadStuntArea(ModelStaging &staging)
 {
-	StuntAreas_wrap *are = adf->FindInstance<StuntAreas_wrap>();
-
-	if (!are)
+	if (staging.stuntAreas.empty())
 		return FALSE;
 
-	StuntAreas *areas = are->Data();
+	ScopedPhase phase(ImportPhase_StuntArea);
 
-	if (!areas->numStuntAreas)
-		return FALSE;
+	std::vector<std::vector<const StuntAreaStaging *>> groups;
 
-	for (int a = 0; a < areas->numStuntAreas; a++)
+	if (mergeStuntAreas)
 	{
-		StuntArea &area = areas->stuntAreas[a];
+		std::unordered_map<std::string, size_t> groupIndices;
 
-		TriObject *obj = CreateNewTriObject();
-		Mesh *msh = &obj->GetMesh();
+		for (auto &area : staging.stuntAreas)
+		{
+			auto found = groupIndices.emplace(area.partName.c_str(), groups.size());
 
-		msh->setNumVerts(area.numDeformPoints);
-		msh->setNumFaces(area.numFaces);
+			if (found.second)
+				groups.emplace_back();
 
-		Matrix3 localCorMat = corMat;
-		localCorMat.Scale({ IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value,IDC_EDIT_SCALE_value });
+			groups[found.first->second].push_back(&area);
+		}
+	}
+	else
+		for (auto &area : staging.stuntAreas)
+			groups.push_back({ &area });
+
+	for (auto &group : groups)
+	{
+		int numVerts = 0;
+		int numFaces = 0;
+
+		for (const StuntAreaStaging *area : group)
+		{
+			numVerts += static_cast<int>(area->vertices.size());
+			numFaces += static_cast<int>(area->indices.size() / 3);
+		}
+
+		const int numAreas = static_cast<int>(group.size());
+		TriObject *obj = mergeStuntAreas ?
+			static_cast<TriObject *>(GetCOREInterface()->CreateInstance(GEOMOBJECT_CLASS_ID, Class_ID(EDITTRIOBJ_CLASS_ID, 0))) :
+			CreateNewTriObject();
+		Mesh *msh = &obj->GetMesh();
 
+		msh->setNumVerts(numVerts);
+		msh->setNumFaces(numFaces);
 
-		for (int v = 0; v < area.numDeformPoints; v++)
-			msh->setVert(v, localCorMat.PointTransform(reinterpret_cast<Point3&>(area.vertices[v])));
+		IMeshSelectData *selectData = mergeStuntAreas ? GetMeshSelectDataInterface(obj) : nullptr;
+		int currentVert = 0;
+		int currentFace = 0;
 
-		for (int f = 0; f < area.numFaces; f++)
+		for (int a = 0; a < numAreas; a++)
 		{
-			Face &face = msh->faces[f];
-			face.setEdgeVisFlags(1, 1, 1);
-			face.v[0] = area.faces[f][0];
-			face.v[1] = area.faces[f][1];
-			face.v[2] = area.faces[f][2];
+			const StuntAreaStaging &area = *group[a];
+			const int numAreaVerts = static_cast<int>(area.vertices.size());
+			const int numAreaFaces = static_cast<int>(area.indices.size() / 3);
+
+			if (selectData)
+			{
+				BitArray areaFaces(numFaces);
+
+				for (int f = 0; f < numAreaFaces; f++)
+					areaFaces.Set(currentFace + f);
+
+				selectData->GetNamedFaceSelList().AppendSet(areaFaces, a, static_cast<TSTRING>(esString(area.name.c_str())).c_str());
+			}
+
+			memcpy(msh->verts + currentVert, area.vertices.data(), numAreaVerts * sizeof(Point3));
+
+			for (int f = 0; f < numAreaFaces; f++, currentFace++)
+			{
+				Face &face = msh->faces[currentFace];
+				face.setEdgeVisFlags(1, 1, 1);
+				face.v[0] = currentVert + area.indices[f * 3];
+				face.v[1] = currentVert + area.indices[f * 3 + 1];
+				face.v[2] = currentVert + area.indices[f * 3 + 2];
+				face.setMatID(static_cast<MtlID>(a));
+			}
+
+			currentVert += numAreaVerts;
 		}
 
 		msh->InvalidateGeomCache();
 		msh->InvalidateTopologyCache();
 
-		INode *nde = GetCOREInterface()->CreateObjectNode(obj);
+		INode *nde = CreateSceneNode(obj);
 		TSTRING boneName = _T("ASA_");
-		boneName += esString(area.name.string.cPtr);
+		boneName += esString((mergeStuntAreas ? group[0]->partName : group[0]->name).c_str());
 		nde->SetName(ToBoneName(boneName));
 
-		boneName = esString(area.partName.string.cPtr);
+		boneName = esString(group[0]->partName.c_str());
 
 		INode *parent = iBoneScanner.LookupNode(boneName);
 		parent->AttachChild(nde);
+	}
+
+	return TRUE;
+}
+
+void ApexImp::BeginImport()
+{
+	logSink.SetMinSeverity(static_cast<LogSeverity>(logLevel));
+	importProfiler.Reset();
+	iMeshInstancer.Reset();
+	importMemory.SetBudget(static_cast<int64_t>(memoryBudgetMB) * 1024 * 1024);
+
+	if (flags[IDC_CH_TRACE_checked])
+		importTrace.Begin();
+
+	if (flags[IDC_CH_LOGFILE_checked])
+	{
+		TSTRING logPath = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
+		logPath.append(_T("\\ApexImp.log"));
+		logSink.OpenFile(logPath.c_str());
+	}
+
+	if (!regionText.empty())
+	{
+		if (region.Empty())
+		{
+			printwarning("[Apex] Couldn't parse region, importing everything: ", << regionText.c_str())
+		}
+		else
+		{
+			printer << "[Apex] Importing only meshes within: " << regionText.c_str() >> 1;
+		}
+	}
+
+	if (optimizeMeshes)
+		printer << "[Apex] Reordering mesh triangles and vertices for vertex cache." >> 1;
+
+	TSTRING archiveCache = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
+	archiveCache.append(_T("\\ApexArchives"));
+	iArchives.SetCacheFolder(archiveCache.c_str());
+	iArchives.OpenList(archiveList.c_str());
+}
 
+void ApexImp::EndImport()
+{
+	iMeshInstancer.Reset();
+	importProfiler.Finish();
+	importProfiler.Report();
+
+	if (importTrace.Enabled())
+	{
+		TSTRING tracePath = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
+		tracePath.append(_T("\\ApexImp.trace.json"));
+
+		if (importTrace.End(tracePath.c_str()))
+		{
+			printer << "[Apex] Import trace saved into: " << tracePath.c_str() >> 1;
+		}
+		else
+		{
+			printerror("[Apex] Couldn't write import trace: ", << tracePath.c_str());
+		}
+	}
+	logSink.Drain();
+	logSink.CloseFile();
+}
+
+bool ApexImp::ResolveSource(const TCHAR *filename, ImportSource &source)
+{
+	TSTRING archivePath;
+	std::string entryPath;
+	source.fileName = filename;
+	source.data = nullptr;
+	source.size = 0;
+
+	if (!SplitArchivePath(filename, archivePath, entryPath))
+		return true;
+
+	ArchiveIndex *index = iArchives.Open(archivePath.c_str());
+	const ArchiveIndex::Entry *entry = index ? index->Find(entryPath.c_str()) : nullptr;
+	source.data = entry ? index->Data(*entry) : nullptr;
+
+	if (!source.data)
+	{
+		printerror("[Apex] Couldn't find archive entry: ", << filename);
+		return false;
+	}
+
+	source.size = entry->size;
+
+	return true;
+}
+
+// Doesn't touch the scene, safe to call from worker threads.
+StagingSettings ApexImp::ImportSettings() const
+{
+	StagingSettings settings;
+	settings.scale = IDC_EDIT_SCALE_value;
+	settings.lodFilter = lodFilter;
+	settings.region = region;
+	settings.boundsOnly = flags[IDC_CH_PROXY_checked];
+	settings.optimizeMeshes = optimizeMeshes;
+
+	return settings;
+}
+
+bool ApexImp::StageFile(const ImportSource &source, ModelStaging &staging, const StagingSettings &settings)
+{
+	ScopedArena arena(&staging.arena);
+
+	{
+		ScopedPhase phase(ImportPhase_FileLoad);
+		bool loaded;
+
+		if (source.data)
+			loaded = staging.adf.Load(source.data, source.size);
+		else
+			loaded = staging.adf.Load(source.fileName.c_str());
+
+		if (!loaded)
+			return false;
+	}
+
+	importProfiler.Add(ImportCounter_Files);
+
+	if (!StageStuntAreas(staging, settings))
+		StageModel(staging, settings);
+
+	return true;
+}
+
+int ApexImp::CommitFile(const TCHAR *filename, ModelStaging &staging)
+{
+	ScopedPhase phase(ImportPhase_Commit);
+	std::unique_ptr<BulkCommit> bulk(bulkCommit ? new BulkCommit : nullptr);
+	iBoneScanner.RescanBones();
+	iMaterialDump.Reset();
+
+	if (!LoadStuntArea(staging) && !LoadModel(staging, filename))
+		return FALSE;
+
+	if (flags[IDC_CH_DUMPMATINFO_checked] && iMaterialDump.NumMaterials())
+	{
+		TSTRING dumpPath = filename;
+		dumpPath.append(_T(".materials.json"));
+
+		if (iMaterialDump.Save(dumpPath))
+		{
+			printer << "[Apex] Dumped " << iMaterialDump.NumMaterials() << " material(s) with " 
+				<< iMaterialDump.NumAttributes() << " attribute(s) into: " << dumpPath.c_str() >> 1;
+		}
+		else
+		{
+			printerror("[Apex] Couldn't write material dump: ", << dumpPath.c_str());
+		}
 	}
 
 	return TRUE;
@@ -920,20 +1742,166 @@ int ApexImp::DoImport(const TCHAR* filename, ImpInterface* /*importerInt*/, Inte
 	if (flags[IDC_CH_CLEARLISTENER_checked])
 		ExecuteMAXScriptScript(_T("ClearListener()"), TRUE);
 
-	iBoneScanner.RescanBones();
+	BeginImport();
 
+	ImportSource source;
+	ModelStaging staging;
+	int result = FALSE;
 
-	IADF *adf = IADF::Create(filename);
+	{
+		ScopedPhase phase(ImportPhase_Total);
 
-	if (!adf)
-		return FALSE;
+		if (ResolveSource(filename, source) && StageFile(source, staging, ImportSettings()))
+			result = CommitFile(filename, staging);
+	}
+
+	setlocale(LC_NUMERIC, oldLocale);
+	EndImport();
 
-	if (!LoadStuntArea(adf))
-		LoadModel(adf);
+	return result;
+}
+
+void ApexImp::SetArchives(const TCHAR *archives)
+{
+	LoadCFG();
+	archiveList = archives;
+	SaveCFG();
+}
+
+Value *ApexImp::ImportBatch(Tab<const TCHAR *> &files, int lookahead, bool bulk)
+{
+	struct BatchItem
+	{
+		ImportSource source;
+		std::unique_ptr<ModelStaging> staging;
+		std::future<bool> task;
+		double stageTime;
+		double commitTime;
+		bool resolved;
+		bool imported;
+
+		BatchItem() : staging(new ModelStaging), stageTime(0.0), commitTime(0.0), resolved(false), imported(false) {}
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+	char *oldLocale = setlocale(LC_NUMERIC, NULL);
+	setlocale(LC_NUMERIC, "en-US");
+
+	LoadCFG();
+	bulkCommit = bulk;
+	BeginImport();
+
+	const StagingSettings settings = ImportSettings();
+
+	const int numFiles = files.Count();
+	std::vector<std::unique_ptr<BatchItem>> items(numFiles);
+
+	if (lookahead < 1)
+		lookahead = 1;
+
+	auto launch = [&](int f)
+	{
+		if (f >= numFiles)
+			return;
+
+		items[f].reset(new BatchItem);
+		BatchItem *item = items[f].get();
+		item->resolved = ResolveSource(files[f], item->source);
+
+		if (!item->resolved)
+			return;
+
+		item->task = taskScheduler->Submit([this, item, &settings]()
+		{
+			ScopedTrace trace("stageFile", static_cast<std::string>(esString(item->source.fileName)));
+			const Clock::time_point start = Clock::now();
+			const bool staged = StageFile(item->source, *item->staging, settings);
+			item->stageTime = std::chrono::duration<double>(Clock::now() - start).count();
+			return staged;
+		});
+	};
+
+	// Over memory budget no more files are staged ahead,
+	// batch falls back to streaming, staging every file right before its commit.
+	// Staging ahead resumes once commits free enough memory.
+	int numLaunched = 0;
+	bool streaming = false;
+
+	auto launchAhead = [&](int limit)
+	{
+		for (; numLaunched < limit && numLaunched < numFiles; numLaunched++)
+		{
+			if (importMemory.OverBudget())
+			{
+				if (!streaming)
+				{
+					printwarning("[Apex] Memory budget exceeded, staging ahead is paused while over ", << memoryBudgetMB << " MB.")
+				}
+
+				streaming = true;
+				return;
+			}
+
+			launch(numLaunched);
+		}
+	};
+
+	launchAhead(lookahead);
+
+	const Clock::time_point batchStart = Clock::now();
+	int numFailed = 0;
+
+	for (int f = 0; f < numFiles; f++)
+	{
+		if (numLaunched <= f)
+			launch(numLaunched++);
+
+		BatchItem *item = items[f].get();
+		const bool staged = item->resolved && taskScheduler->Wait(item->task);
+
+		launchAhead(f + 1 + lookahead);
+
+		if (staged)
+		{
+			const Clock::time_point start = Clock::now();
+			item->imported = CommitFile(files[f], *item->staging) != FALSE;
+			item->commitTime = std::chrono::duration<double>(Clock::now() - start).count();
+		}
+
+		if (!item->imported)
+		{
+			numFailed++;
+			printerror("[Apex] Batch import failed for: ", << files[f]);
+		}
+
+		// Free scene independent data and its arena right away, only timings are kept.
+		item->staging.reset();
+	}
+
+	const Clock::duration batchDuration = Clock::now() - batchStart;
+	const double batchTime = std::chrono::duration<double>(batchDuration).count();
+	importProfiler.AddTime(ImportPhase_Total, batchDuration);
+
+	printer << "[Apex] Batch imported " << numFiles - numFailed << "/" << numFiles << " file(s) in " << batchTime << "s" << (bulk ? " (bulk commit)" : "") >> 1;
 
 	setlocale(LC_NUMERIC, oldLocale);
+	EndImport();
 
-	delete adf;
-	return TRUE;
+	one_typed_value_local(Array *result);
+	vl.result = new Array(numFiles);
+
+	for (int f = 0; f < numFiles; f++)
+	{
+		BatchItem *item = items[f].get();
+		Array *entry = new Array(4);
+		entry->append(new String(files[f]));
+		entry->append(item->imported ? &true_value : &false_value);
+		entry->append(Float::intern(static_cast<float>(item->stageTime)));
+		entry->append(Float::intern(static_cast<float>(item->commitTime)));
+		vl.result->append(entry);
+	}
+
+	return_value(vl.result);
 }
 	
@@ -0,0 +1,152 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Asset metadata index tool, builds and queries index written by BuildAssetIndex.
+// Usage: apexmax-index build FOLDER INDEX [-threads N] [-nobounds]
+//        apexmax-index list INDEX
+//        apexmax-index texture INDEX PATH
+//        apexmax-index material INDEX HASH
+//        apexmax-index vertices INDEX N
+// -nobounds skips decode of position streams, bounds are left out of the index.
+// Material hash is hexadecimal, texture path is the one stored in materials, e.g. textures/props/crate_dif.ddsc.
+
+#include "AssetIndex.h"
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void PrintModel(const AssetIndex &index, uint32_t modelIndex)
+{
+	const AssetIndexModel &model = index.Model(modelIndex);
+
+	printf("%s\n\tLODs: %u, meshes: %u, vertices: %llu, skinned bones: %u, materials: %u, textures: %u\n", index.String(model.path),
+		model.numLODs, model.numMeshes, static_cast<unsigned long long>(model.numVertices), model.numSkinnedBones, model.numMaterials,
+		model.numTextures);
+
+	if (model.numMeshes && !(model.flags & AssetIndexModel::FLAG_NO_BOUNDS))
+		printf("\tbounds: [%g %g %g] [%g %g %g]\n", model.boundsMin[0], model.boundsMin[1], model.boundsMin[2],
+			model.boundsMax[0], model.boundsMax[1], model.boundsMax[2]);
+}
+
+static int Build(const char *folder, const char *indexPath, int numWorkers, bool withBounds)
+{
+	taskScheduler = new TaskScheduler(numWorkers);
+
+	AssetScanStats stats;
+	const Clock::time_point start = Clock::now();
+	const bool saved = BuildAssetIndex(folder, indexPath, stats, withBounds);
+	const double buildTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	delete taskScheduler;
+	taskScheduler = nullptr;
+
+	printf("folders: %zu, model files: %zu, indexed: %zu, failed: %zu\n", stats.numFolders, stats.numFiles, stats.numIndexed,
+		stats.numFailed);
+	printf("build: %.3fs, %.1f files/s\n", buildTime, buildTime > 0.0 ? stats.numFiles / buildTime : 0.0);
+
+	if (!saved)
+	{
+		printf("Couldn't write index: %s\n", indexPath);
+		return 2;
+	}
+
+	return 0;
+}
+
+static void PrintModels(const AssetIndex &index, const std::vector<uint32_t> &models)
+{
+	for (uint32_t m : models)
+		PrintModel(index, m);
+
+	printf("%zu models\n", models.size());
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 3 && !strcmp(argv[1], "build"))
+	{
+		int numWorkers = 0;
+		bool withBounds = true;
+
+		for (int a = 4; a < argc; a++)
+			if (!strcmp(argv[a], "-threads") && a + 1 < argc)
+				numWorkers = atoi(argv[++a]);
+			else if (!strcmp(argv[a], "-nobounds"))
+				withBounds = false;
+
+		return Build(argv[2], argv[3], numWorkers, withBounds);
+	}
+
+	if (argc < 3)
+	{
+		printf("Usage: apexmax-index build FOLDER INDEX [-threads N] [-nobounds]\n"
+			"       apexmax-index list INDEX\n"
+			"       apexmax-index texture INDEX PATH\n"
+			"       apexmax-index material INDEX HASH\n"
+			"       apexmax-index vertices INDEX N\n");
+		return 1;
+	}
+
+	AssetIndex index;
+
+	if (!index.Open(argv[2]))
+	{
+		printf("Couldn't open index: %s\n", argv[2]);
+		return 2;
+	}
+
+	std::vector<uint32_t> models;
+
+	if (!strcmp(argv[1], "list"))
+	{
+		for (size_t m = 0; m < index.NumModels(); m++)
+			models.push_back(static_cast<uint32_t>(m));
+	}
+	else if (!strcmp(argv[1], "texture") && argc > 3)
+		index.ModelsUsingTexture(argv[3], models);
+	else if (!strcmp(argv[1], "material") && argc > 3)
+		index.ModelsUsingMaterial(static_cast<uint32_t>(strtoul(argv[3], nullptr, 16)), models);
+	else if (!strcmp(argv[1], "vertices") && argc > 3)
+	{
+		const uint32_t *meshes = nullptr;
+		const size_t numMeshes = index.MeshesAbove(static_cast<uint32_t>(strtoul(argv[3], nullptr, 10)), meshes);
+
+		for (size_t m = 0; m < numMeshes; m++)
+		{
+			const AssetIndexMesh &mesh = index.Mesh(meshes[m]);
+			printf("%s: %s, LOD %i, vertices: %u\n", index.String(index.Model(mesh.model).path), index.String(mesh.name),
+				mesh.lodIndex, mesh.numVertices);
+		}
+
+		printf("%zu meshes\n", numMeshes);
+		return 0;
+	}
+	else
+	{
+		printf("Unknown query: %s\n", argv[1]);
+		return 1;
+	}
+
+	PrintModels(index, models);
+
+	return 0;
+}
@@ -27,6 +27,8 @@
 #include "datas/esstring.h"
 #include "datas/masterprinter.hpp"
 #include "datas/fileinfo.hpp"
+#include "ApexArchive.h"
+#include "ImportProfiler.h"
 
 #define ADFMATERIAL(classname) void classname##MaterialLoad(void*, StdMat2* material, TexmapMapping& textures)
 #define ADFMATERIAL_WPROPS(classname) void classname##MaterialLoad(void* properties, StdMat2* material, TexmapMapping& textures)
@@ -3052,11 +3054,13 @@ bool LinkedTexmap(MtlBase *item, Texmap *ref)
 	return false;
 }
 
-Mtl *CreateMaterial(AmfMaterial *material)
+Mtl *CreateMaterial(AmfMaterial *material, bool forceStandard, const ArchiveSet *archives)
 {
+	ScopedPhase phase(ImportPhase_Materials, material->GetName());
+	importProfiler.Add(ImportCounter_Materials);
 	StdMat2 *mat = nullptr;
 
-	if (material->GetMaterialType() == MaterialType_PBR)
+	if (material->GetMaterialType() == MaterialType_PBR && !forceStandard)
 		mat = PhysicalMaterial();
 
 	if (!mat)
@@ -3089,8 +3093,13 @@ Mtl *CreateMaterial(AmfMaterial *material)
 		{
 			ctex = NewDefaultBitmapTex();
 			TSTRING mapName = esString(texName);
+
+			if (archives)
+				archives->ExtractEntry(texName, mapName);
+
 			ctex->SetMapName(mapName.c_str());
 			ctex->SetName(TFileInfo(mapName).GetFileName().c_str());
+			importProfiler.Add(ImportCounter_Textures);
 		}
 		
 		texmaps.push_back(ctex);
@@ -36,7 +36,9 @@ const TCHAR _homePage[] = _T("https://lukascone.wordpress.com/2019/02/22/apex-en
 #include "MAXex/win/AboutDlg.h"
 
 ApexImport::ApexImport(): CFGFile(nullptr), hWnd(nullptr),
-flags(IDC_CH_DEBUGNAME_checked, IDC_CH_DUMPMATINFO_checked), IDConfigValue(IDC_EDIT_SCALE)(145.f) {}
+flags(IDC_CH_DEBUGNAME_checked, IDC_CH_DUMPMATINFO_checked), IDConfigValue(IDC_EDIT_SCALE)(145.f), logLevel(0), memoryBudgetMB(0), instanceMeshes(true), bulkCommit(true), mergeStuntAreas(false), optimizeMeshes(false) {}
+
+static const TCHAR advancedGroup[] = _T("Advanced");
 
 void ApexImport::BuildCFG()
 {
@@ -55,6 +57,31 @@ void ApexImport::LoadCFG()
 	GetCFGChecked(IDC_CH_CLEARLISTENER);
 	GetCFGChecked(IDC_CH_FORCESTDMAT);
 	GetCFGChecked(IDC_CH_ENABLEVIEWMAT);
+	GetCFGChecked(IDC_CH_LOGFILE);
+	GetCFGChecked(IDC_CH_TRACE);
+	GetCFGChecked(IDC_CH_REIMPORT);
+	GetCFGChecked(IDC_CH_PROXY);
+
+	logLevel = GetPrivateProfileInt(advancedGroup, _T("LogLevel"), logLevel, CFGFile);
+	memoryBudgetMB = GetPrivateProfileInt(advancedGroup, _T("MemoryBudgetMB"), memoryBudgetMB, CFGFile);
+	instanceMeshes = GetPrivateProfileInt(advancedGroup, _T("InstanceMeshes"), instanceMeshes, CFGFile) != 0;
+	bulkCommit = GetPrivateProfileInt(advancedGroup, _T("BulkCommit"), bulkCommit, CFGFile) != 0;
+	mergeStuntAreas = GetPrivateProfileInt(advancedGroup, _T("MergeStuntAreas"), mergeStuntAreas, CFGFile) != 0;
+	optimizeMeshes = GetPrivateProfileInt(advancedGroup, _T("OptimizeMeshes"), optimizeMeshes, CFGFile) != 0;
+
+	TCHAR lodBuffer[64];
+	GetPrivateProfileString(advancedGroup, _T("LODs"), lodFilterText.c_str(), lodBuffer, _countof(lodBuffer), CFGFile);
+	lodFilterText = lodBuffer;
+	lodFilter.Parse(lodFilterText.c_str());
+
+	TCHAR regionBuffer[128];
+	GetPrivateProfileString(advancedGroup, _T("Region"), regionText.c_str(), regionBuffer, _countof(regionBuffer), CFGFile);
+	regionText = regionBuffer;
+	region.Parse(regionText.c_str());
+
+	TCHAR archiveBuffer[1024];
+	GetPrivateProfileString(advancedGroup, _T("Archives"), archiveList.c_str(), archiveBuffer, _countof(archiveBuffer), CFGFile);
+	archiveList = archiveBuffer;
 }
 
 void ApexImport::SaveCFG()
@@ -66,10 +93,26 @@ void ApexImport::SaveCFG()
 	SetCFGChecked(IDC_CH_CLEARLISTENER);
 	SetCFGChecked(IDC_CH_FORCESTDMAT);
 	SetCFGChecked(IDC_CH_ENABLEVIEWMAT);
+	SetCFGChecked(IDC_CH_LOGFILE);
+	SetCFGChecked(IDC_CH_TRACE);
+	SetCFGChecked(IDC_CH_REIMPORT);
+	SetCFGChecked(IDC_CH_PROXY);
 
 	TCHAR buffer[16];
 	SetCFGValue(IDC_EDIT_SCALE);
 
+	_itot_s(logLevel, buffer, 10);
+	WritePrivateProfileString(advancedGroup, _T("LogLevel"), buffer, CFGFile);
+	_itot_s(memoryBudgetMB, buffer, 10);
+	WritePrivateProfileString(advancedGroup, _T("MemoryBudgetMB"), buffer, CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("InstanceMeshes"), instanceMeshes ? _T("1") : _T("0"), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("BulkCommit"), bulkCommit ? _T("1") : _T("0"), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("MergeStuntAreas"), mergeStuntAreas ? _T("1") : _T("0"), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("OptimizeMeshes"), optimizeMeshes ? _T("1") : _T("0"), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("LODs"), lodFilterText.c_str(), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("Region"), regionText.c_str(), CFGFile);
+	WritePrivateProfileString(advancedGroup, _T("Archives"), archiveList.c_str(), CFGFile);
+
 	WriteText(hkpresetgroup, _T("Apex Engine"), CFGFile, _T("Name"));
 	WriteText(hkpresetgroup, _T("bsk|ban"), CFGFile, _T("Extensions"));
 	WriteValue(hkpresetgroup, IDConfigValue(IDC_EDIT_SCALE), CFGFile, buffer, _T("Scale"));
@@ -88,6 +131,11 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
 		imp->hWnd = hWnd;
 		imp->LoadCFG();
 		SetupIntSpinner(hWnd, IDC_SPIN_SCALE, IDC_EDIT_SCALE, 0, 5000, imp->IDC_EDIT_SCALE_value);
+		{
+			ICustEdit *lodEdit = GetICustEdit(GetDlgItem(hWnd, IDC_EDIT_LODS));
+			lodEdit->SetText(imp->lodFilterText.c_str());
+			ReleaseICustEdit(lodEdit);
+		}
 		SetWindowText(hWnd, _T("Apex Import v" ApexMax_VERSION));
 		return TRUE;
 
@@ -100,6 +148,14 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
 		switch (LOWORD(wParam))
 		{
 		case IDC_BT_DONE:
+		{
+			ICustEdit *lodEdit = GetICustEdit(GetDlgItem(hWnd, IDC_EDIT_LODS));
+			TCHAR lodBuffer[64];
+			lodEdit->GetText(lodBuffer, _countof(lodBuffer));
+			ReleaseICustEdit(lodEdit);
+			imp->lodFilterText = lodBuffer;
+			imp->lodFilter.Parse(lodBuffer);
+		}
 			EndDialog(hWnd, 1);
 			imp->SaveCFG();
 			return 1;
@@ -116,6 +172,10 @@ static INT_PTR CALLBACK DialogCallbacks(HWND hWnd, UINT message, WPARAM wParam,
 			MSGCheckbox(IDC_CH_CLEARLISTENER); break;
 			MSGCheckbox(IDC_CH_FORCESTDMAT); break;
 			MSGCheckbox(IDC_CH_ENABLEVIEWMAT); break;
+			MSGCheckbox(IDC_CH_LOGFILE); break;
+			MSGCheckbox(IDC_CH_TRACE); break;
+			MSGCheckbox(IDC_CH_REIMPORT); break;
+			MSGCheckbox(IDC_CH_PROXY); break;
 		}
 
 	case CC_SPINNER_CHANGE:
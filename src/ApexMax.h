@@ -31,10 +31,12 @@
 #include "resource.h"
 #include <tchar.h>
 #include <string>
+#include <vector>
 #include <windows.h>
 #include <matrix3.h>
 
 #include "ApexApi.h"
+#include "ModelStaging.h"
 #include "../project.h"
 
 static constexpr int APEXMAX_VERSIONINT = ApexMax_VERSION_MAJOR * 100 + ApexMax_VERSION_MINOR;
@@ -55,11 +57,26 @@ public:
 		IDConfigBool(IDC_CH_CLEARLISTENER),
 		IDConfigBool(IDC_CH_FORCESTDMAT),
 		IDConfigBool(IDC_CH_ENABLEVIEWMAT),
+		IDConfigBool(IDC_CH_LOGFILE),
+		IDConfigBool(IDC_CH_TRACE),
+		IDConfigBool(IDC_CH_REIMPORT),
+		IDConfigBool(IDC_CH_PROXY),
 	};
 
 	NewIDConfigValue(IDC_EDIT_SCALE);
 
-	EnumFlags<uchar, ConfigBoolean> flags;
+	EnumFlags<ushort, ConfigBoolean> flags;
+	int logLevel;
+	int memoryBudgetMB;
+	bool instanceMeshes;
+	bool bulkCommit;
+	bool mergeStuntAreas;
+	bool optimizeMeshes;
+	TSTRING lodFilterText;
+	TSTRING archiveList;
+	LODFilter lodFilter;
+	TSTRING regionText;
+	StagingRegion region;
 
 	ApexImport();
 	~ApexImport() {}
@@ -0,0 +1,303 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Scale test corpus generator, writes synthetic models for headless tools.
+// Built only with APEXMAX_SYNTHETIC_MODELS option, 3ds Max importer does not read these files.
+// Usage: apexmax-synthgen [-lods N] [-meshes N] [-verts N] [-submeshes N] [-bones N] [-materials N] [-files N] -out FILE
+// Counts of meshes and vertices are per LOD and per mesh, vertices are capped at 16 bit indexing.
+// Materials have names and textures only, every other one is flagged PBR.
+
+#include "SyntheticModel.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint32_t numTextureSlots = 20;
+static const int maxMeshVertices = 0x10000;
+
+struct SynthSettings
+{
+	int numLODs = 1;
+	int numMeshes = 4;
+	int numVertices = 4096;
+	int numSubMeshes = 1;
+	int numBones = 0;
+	int numMaterials = 4;
+	int numFiles = 1;
+};
+
+class SynthWriter
+{
+	std::vector<char> buffer;
+
+public:
+	void Align() { buffer.resize(SyntheticAlign(buffer.size())); }
+
+	void Write(const void *data, size_t size)
+	{
+		Align();
+		const char *cData = static_cast<const char *>(data);
+		buffer.insert(buffer.end(), cData, cData + size);
+	}
+
+	template<class Type>
+	void Write(const Type &item) { Write(&item, sizeof(Type)); }
+
+	template<class Type>
+	void Write(const std::vector<Type> &items) { Write(items.data(), items.size() * sizeof(Type)); }
+
+	bool Save(const char *path)
+	{
+		FILE *fle = fopen(path, "wb");
+
+		if (!fle)
+			return false;
+
+		const bool written = fwrite(buffer.data(), 1, buffer.size(), fle) == buffer.size();
+		fclose(fle);
+
+		return written;
+	}
+
+	size_t Size() const { return buffer.size(); }
+};
+
+// FNV-1a, only has to be stable between materials and submeshes.
+static uint32_t SynthHash(const std::string &str)
+{
+	uint32_t hash = 2166136261u;
+
+	for (char c : str)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+
+	return hash;
+}
+
+static void CopyName(char *dest, const std::string &src)
+{
+	memset(dest, 0, SYNTHETIC_NAME_SIZE);
+	strncpy(dest, src.c_str(), SYNTHETIC_NAME_SIZE - 1);
+}
+
+static std::string MaterialName(int materialIndex)
+{
+	return "synth_mat" + std::to_string(materialIndex);
+}
+
+static void WriteMaterial(SynthWriter &wr, int materialIndex)
+{
+	const std::string name = MaterialName(materialIndex);
+
+	SyntheticMaterial mat = {};
+	CopyName(mat.name, name);
+	mat.nameHash = SynthHash(name);
+	mat.pbr = materialIndex & 1;
+	mat.numTextures = numTextureSlots;
+	wr.Write(mat);
+
+	std::vector<char> textures(numTextureSlots * SYNTHETIC_NAME_SIZE, 0);
+
+	for (int t = 0; t < 3; t++)
+	{
+		const std::string texName = "textures/synth/" + name + "_" + std::to_string(t) + ".ddsc";
+		CopyName(textures.data() + t * SYNTHETIC_NAME_SIZE, texName);
+	}
+
+	wr.Write(textures);
+}
+
+// Regular grid on XZ plane with a bit of height, split into equal submesh strips.
+static void WriteMesh(SynthWriter &wr, const SynthSettings &settings, int lodIndex, int meshIndex)
+{
+	const int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(settings.numVertices))));
+	const int numVerts = gridSize * gridSize;
+	const int numQuads = (gridSize - 1) * (gridSize - 1);
+	const int numInfluences = settings.numBones > 1 ? 4 : 0;
+
+	std::vector<uint16_t> indices;
+	indices.reserve(numQuads * 6);
+
+	for (int y = 0; y < gridSize - 1; y++)
+		for (int x = 0; x < gridSize - 1; x++)
+		{
+			const uint16_t i0 = static_cast<uint16_t>(y * gridSize + x), i1 = i0 + 1,
+				i2 = static_cast<uint16_t>(i0 + gridSize), i3 = i2 + 1;
+			const uint16_t quad[] = { i0, i2, i1, i1, i2, i3 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+
+	const int numSubMeshes = settings.numSubMeshes > numQuads ? numQuads : settings.numSubMeshes;
+	std::vector<SyntheticSubMesh> subMeshes(numSubMeshes);
+
+	for (int s = 0; s < numSubMeshes; s++)
+	{
+		const int materialIndex = (meshIndex + s) % settings.numMaterials;
+		subMeshes[s].nameHash = SynthHash(MaterialName(materialIndex));
+		subMeshes[s].numIndices = (numQuads / numSubMeshes + (s < numQuads % numSubMeshes)) * 6;
+	}
+
+	std::vector<int32_t> remaps(settings.numBones);
+
+	for (int b = 0; b < settings.numBones; b++)
+		remaps[b] = b;
+
+	std::vector<float> positions(numVerts * 3), normals(numVerts * 3), uvs(numVerts * 2);
+	std::vector<uint8_t> boneIndices(numVerts * numInfluences);
+	std::vector<float> boneWeights(numVerts * numInfluences);
+	const float spacing = 0.1f;
+
+	for (int v = 0; v < numVerts; v++)
+	{
+		const int x = v % gridSize, y = v / gridSize;
+		const float u = static_cast<float>(x) / (gridSize - 1), w = static_cast<float>(y) / (gridSize - 1);
+
+		positions[v * 3] = x * spacing + meshIndex * gridSize * spacing;
+		positions[v * 3 + 1] = std::sin(u * 6.2831853f) * std::cos(w * 6.2831853f) * 0.25f;
+		positions[v * 3 + 2] = y * spacing;
+		normals[v * 3 + 1] = 1.0f;
+		uvs[v * 2] = u;
+		uvs[v * 2 + 1] = w;
+
+		for (int i = 0; i < numInfluences; i++)
+		{
+			boneIndices[v * numInfluences + i] = static_cast<uint8_t>((x + i) % settings.numBones);
+			boneWeights[v * numInfluences + i] = i ? 0.5f / (numInfluences - 1) : 0.5f;
+		}
+	}
+
+	SyntheticMesh hdr = {};
+	CopyName(hdr.name, "synth_lod" + std::to_string(lodIndex) + "_mesh" + std::to_string(meshIndex));
+	hdr.numVertices = numVerts;
+	hdr.numSubMeshes = numSubMeshes;
+	hdr.numRemaps = settings.numBones;
+	hdr.numInfluences = numInfluences;
+
+	wr.Write(hdr);
+	wr.Write(subMeshes);
+	wr.Write(remaps);
+	wr.Write(positions);
+	wr.Write(normals);
+	wr.Write(uvs);
+	wr.Write(boneIndices);
+	wr.Write(boneWeights);
+	wr.Write(indices);
+}
+
+static bool WriteModel(const char *path, const SynthSettings &settings)
+{
+	SynthWriter wr;
+
+	SyntheticHeader hdr = {};
+	hdr.magic = SyntheticHeader::ID;
+	hdr.version = SyntheticHeader::VERSION;
+	hdr.numMaterials = settings.numMaterials;
+	hdr.numLODs = settings.numLODs;
+	wr.Write(hdr);
+
+	for (int m = 0; m < settings.numMaterials; m++)
+		WriteMaterial(wr, m);
+
+	for (int l = 0; l < settings.numLODs; l++)
+	{
+		SyntheticLOD lod = {};
+		lod.lodIndex = l;
+		lod.numMeshes = settings.numMeshes;
+		wr.Write(lod);
+
+		for (int m = 0; m < settings.numMeshes; m++)
+			WriteMesh(wr, settings, l, m);
+	}
+
+	if (!wr.Save(path))
+		return false;
+
+	printf("%s: %.2f MB\n", path, wr.Size() / (1024.0 * 1024.0));
+
+	return true;
+}
+
+static int Clamp(int value, int minValue, int maxValue)
+{
+	return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+int main(int argc, char *argv[])
+{
+	SynthSettings settings;
+	const char *outPath = nullptr;
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-lods") && a + 1 < argc)
+			settings.numLODs = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-meshes") && a + 1 < argc)
+			settings.numMeshes = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-verts") && a + 1 < argc)
+			settings.numVertices = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-submeshes") && a + 1 < argc)
+			settings.numSubMeshes = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-bones") && a + 1 < argc)
+			settings.numBones = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-materials") && a + 1 < argc)
+			settings.numMaterials = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-files") && a + 1 < argc)
+			settings.numFiles = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-out") && a + 1 < argc)
+			outPath = argv[++a];
+	}
+
+	if (!outPath)
+	{
+		printf("Usage: apexmax-synthgen [-lods N] [-meshes N] [-verts N] [-submeshes N] [-bones N] [-materials N] [-files N] -out FILE\n");
+		return 1;
+	}
+
+	settings.numLODs = Clamp(settings.numLODs, 1, 16);
+	settings.numMeshes = Clamp(settings.numMeshes, 1, 0x10000);
+	settings.numVertices = Clamp(settings.numVertices, 4, maxMeshVertices);
+	settings.numSubMeshes = Clamp(settings.numSubMeshes, 1, 256);
+	settings.numBones = Clamp(settings.numBones, 0, 256);
+	settings.numMaterials = Clamp(settings.numMaterials, 1, 0x10000);
+	settings.numFiles = Clamp(settings.numFiles, 1, 0x10000);
+
+	for (int f = 0; f < settings.numFiles; f++)
+	{
+		std::string path = outPath;
+
+		if (settings.numFiles > 1)
+		{
+			const size_t extPos = path.find_last_of('.');
+			const std::string suffix = "_" + std::to_string(f);
+
+			if (extPos == std::string::npos || path.find_first_of("/\\", extPos) != std::string::npos)
+				path.append(suffix);
+			else
+				path.insert(extPos, suffix);
+		}
+
+		if (!WriteModel(path.c_str(), settings))
+		{
+			printf("Couldn't write: %s\n", path.c_str());
+			return 2;
+		}
+	}
+
+	return 0;
+}
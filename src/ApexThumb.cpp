@@ -0,0 +1,217 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Headless thumbnail renderer, writes a PNG of the highest detail LOD for every model.
+// Usage: apexmax-thumb [-size N] [-supersample N] [-shading flat|smooth|normals] [-textures FOLDER] [-yaw N] [-pitch N] [-threads N] -out FOLDER path...
+// Paths can be model files or folders, folders are searched recursively and their subfolders end up in PNG names.
+// -textures enables diffuse textures, material texture paths are resolved under FOLDER.
+
+#include "AssetIndex.h"
+#include "SyntheticModel.h"
+#include "TaskScheduler.h"
+#include "Thumbnail.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+typedef std::chrono::steady_clock Clock;
+
+struct ThumbnailJob
+{
+	std::string fileName;
+	std::string outName;
+};
+
+// Some models start at LOD1, "first" picks the lowest index present in a single pass.
+static bool StageHighestLOD(ModelStaging &staging, const char *fileName)
+{
+	if (!LoadSyntheticModel(fileName, staging.syntheticData) && !staging.adf.Load(fileName))
+		return false;
+
+	StagingSettings settings;
+	settings.lodFilter.Parse("first");
+
+	return staging.syntheticData.size() ? StageSyntheticModel(staging, settings) : StageModel(staging, settings);
+}
+
+static bool IsFolder(const char *path)
+{
+	struct stat info;
+	return !stat(path, &info) && (info.st_mode & S_IFMT) == S_IFDIR;
+}
+
+static std::string ThumbnailName(const std::string &relativePath)
+{
+	std::string name = relativePath;
+
+	for (char &c : name)
+		if (c == '/' || c == '\\')
+			c = '_';
+
+	const size_t dot = name.find_last_of('.');
+
+	if (dot != std::string::npos)
+		name.resize(dot);
+
+	return name + ".png";
+}
+
+int main(int argc, char *argv[])
+{
+	ThumbnailSettings settings;
+	ThumbnailTextureCache textures;
+	const char *outFolder = nullptr;
+	int numWorkers = 0;
+	std::vector<const char *> paths;
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-size") && a + 1 < argc)
+			settings.size = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-supersample") && a + 1 < argc)
+			settings.supersample = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-shading") && a + 1 < argc)
+		{
+			const char *shading = argv[++a];
+
+			if (!strcmp(shading, "flat"))
+				settings.shading = ThumbnailShading_Flat;
+			else if (!strcmp(shading, "smooth"))
+				settings.shading = ThumbnailShading_Smooth;
+			else if (!strcmp(shading, "normals"))
+				settings.shading = ThumbnailShading_Normals;
+			else
+			{
+				printf("Invalid shading: %s\n", shading);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[a], "-textures") && a + 1 < argc)
+		{
+			textures.SetRootFolder(argv[++a]);
+			settings.textured = true;
+		}
+		else if (!strcmp(argv[a], "-yaw") && a + 1 < argc)
+			settings.yaw = static_cast<float>(atof(argv[++a]));
+		else if (!strcmp(argv[a], "-pitch") && a + 1 < argc)
+			settings.pitch = static_cast<float>(atof(argv[++a]));
+		else if (!strcmp(argv[a], "-threads") && a + 1 < argc)
+			numWorkers = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-out") && a + 1 < argc)
+			outFolder = argv[++a];
+		else
+			paths.push_back(argv[a]);
+	}
+
+	if (paths.empty() || !outFolder)
+	{
+		printf("Usage: apexmax-thumb [-size N] [-supersample N] [-shading flat|smooth|normals] [-textures FOLDER] [-yaw N] [-pitch N] "
+			"[-threads N] -out FOLDER path...\n");
+		return 1;
+	}
+
+	_tmkdir(outFolder);
+	taskScheduler = new TaskScheduler(numWorkers);
+
+	const Clock::time_point scanStart = Clock::now();
+	std::vector<ThumbnailJob> jobs;
+
+	for (const char *path : paths)
+	{
+		if (!IsFolder(path))
+		{
+			const char *fileName = strrchr(path, '/');
+			const char *backslash = strrchr(path, '\\');
+			fileName = backslash > fileName ? backslash : fileName;
+			jobs.push_back({ path, ThumbnailName(fileName ? fileName + 1 : path) });
+			continue;
+		}
+
+		std::vector<TSTRING> files;
+		FindAssetFiles(path, files);
+
+		const size_t rootSize = strlen(path);
+		const bool rootSeparator = path[rootSize - 1] == '/' || path[rootSize - 1] == '\\';
+
+		for (auto &f : files)
+		{
+			const std::string fileName = static_cast<std::string>(esString(f));
+			jobs.push_back({ fileName, ThumbnailName(fileName.substr(rootSeparator ? rootSize : rootSize + 1)) });
+		}
+	}
+
+	const Clock::time_point renderStart = Clock::now();
+	std::atomic<size_t> numRendered(0);
+	std::atomic<int64_t> numTriangles(0);
+
+	// Models render in parallel, every model also splits its tiles over the same workers.
+	taskScheduler->ParallelFor(jobs.size(), [&](size_t j)
+	{
+		const ThumbnailJob &job = jobs[j];
+		ModelStaging staging;
+		ScopedArena arena(&staging.arena);
+
+		if (!StageHighestLOD(staging, job.fileName.c_str()))
+		{
+			printf("%s: couldn't load model.\n", job.fileName.c_str());
+			return;
+		}
+
+		ThumbnailImage image;
+
+		if (!RenderThumbnail(staging, settings, &textures, image))
+		{
+			printf("%s: nothing to render.\n", job.fileName.c_str());
+			return;
+		}
+
+		const std::string outPath = std::string(outFolder) + "/" + job.outName;
+
+		if (!image.SavePNG(outPath.c_str()))
+		{
+			printf("Couldn't write: %s\n", outPath.c_str());
+			return;
+		}
+
+		int64_t numModelTriangles = 0;
+
+		for (auto &lod : staging.lods)
+			for (auto &mesh : lod.meshes)
+				numModelTriangles += mesh.faces.size();
+
+		numTriangles += numModelTriangles;
+		numRendered++;
+	});
+
+	const Clock::time_point renderEnd = Clock::now();
+	const double scanTime = std::chrono::duration<double>(renderStart - scanStart).count();
+	const double renderTime = std::chrono::duration<double>(renderEnd - renderStart).count();
+
+	printf("models: %zu, rendered: %zu, failed: %zu, triangles: %lld\n", jobs.size(), numRendered.load(), jobs.size() - numRendered.load(),
+		static_cast<long long>(numTriangles.load()));
+	printf("scan: %.3fs, render: %.3fs, %.1f models/s\n", scanTime, renderTime, renderTime > 0.0 ? numRendered / renderTime : 0.0);
+
+	delete taskScheduler;
+	taskScheduler = nullptr;
+
+	return numRendered == jobs.size() ? 0 : 2;
+}
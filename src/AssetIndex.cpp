@@ -0,0 +1,484 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AssetIndex.h"
+#include "ApexArchive.h"
+#include "ModelStaging.h"
+#include "SyntheticModel.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+#include <set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+static_assert(sizeof(AssetIndexHeader) % 8 == 0 && sizeof(AssetIndexModel) % 8 == 0,
+	"Models must stay 8 byte aligned in mapped index");
+
+static const TCHAR *const assetExtensions[] = { _T(".modelc"), _T(".rbm"), _T(".rbn"), _T(".vmodc") };
+
+static bool IsAssetFile(const TSTRING &fileName)
+{
+	const size_t dot = fileName.find_last_of('.');
+
+	if (dot == TSTRING::npos)
+		return false;
+
+	for (const TCHAR *ext : assetExtensions)
+		if (!_tcsicmp(fileName.c_str() + dot, ext))
+			return true;
+
+	return false;
+}
+
+static void ListFolder(const TSTRING &folder, std::vector<TSTRING> &outFolders, std::vector<TSTRING> &outFiles)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATA findData;
+	HANDLE found = FindFirstFile((folder + _T("\\*")).c_str(), &findData);
+
+	if (found == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		const TCHAR *name = findData.cFileName;
+
+		if (!_tcscmp(name, _T(".")) || !_tcscmp(name, _T("..")))
+			continue;
+
+		const TSTRING path = folder + _T("\\") + name;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			outFolders.push_back(path);
+		else if (IsAssetFile(path))
+			outFiles.push_back(path);
+	} while (FindNextFile(found, &findData));
+
+	FindClose(found);
+#else
+	DIR *dir = opendir(folder.c_str());
+
+	if (!dir)
+		return;
+
+	while (dirent *entry = readdir(dir))
+	{
+		const char *name = entry->d_name;
+
+		if (!strcmp(name, ".") || !strcmp(name, ".."))
+			continue;
+
+		const TSTRING path = folder + "/" + name;
+		bool isFolder = entry->d_type == DT_DIR;
+
+		if (entry->d_type == DT_UNKNOWN)
+		{
+			struct stat info;
+			isFolder = !stat(path.c_str(), &info) && S_ISDIR(info.st_mode);
+		}
+
+		if (isFolder)
+			outFolders.push_back(path);
+		else if (IsAssetFile(path))
+			outFiles.push_back(path);
+	}
+
+	closedir(dir);
+#endif
+}
+
+static void RunParallel(size_t count, const std::function<void(size_t)> &func)
+{
+	if (taskScheduler)
+		taskScheduler->ParallelFor(count, func, TaskPriority_Low);
+	else
+		for (size_t i = 0; i < count; i++)
+			func(i);
+}
+
+bool ScanAsset(const TCHAR *fileName, AssetRecord &outRecord, bool withBounds)
+{
+	ModelStaging staging;
+	ScopedArena arena(&staging.arena);
+
+	if (!LoadSyntheticModel(fileName, staging.syntheticData) && !staging.adf.Load(fileName))
+		return false;
+
+	// Bounds need position streams of every mesh, boundsOnly skips decode of the rest.
+	StagingSettings settings;
+	settings.boundsOnly = true;
+	settings.headersOnly = !withBounds;
+
+	const bool staged = staging.syntheticData.size() ? StageSyntheticModel(staging, settings) : StageModel(staging, settings);
+
+	if (!staged)
+		return false;
+
+	outRecord.path = static_cast<std::string>(esString(fileName));
+	outRecord.numLODs = static_cast<int>(staging.lods.size());
+	outRecord.hasBounds = withBounds;
+
+	std::set<int> bones;
+
+	for (auto &lod : staging.lods)
+		for (auto &mesh : lod.meshes)
+		{
+			AssetRecord::Mesh rmesh;
+			rmesh.name.assign(mesh.name.data(), mesh.name.size());
+			rmesh.lodIndex = lod.lodIndex;
+			rmesh.numVertices = static_cast<uint32_t>(mesh.numVertices);
+			memcpy(rmesh.boundsMin, &mesh.boundsMin, sizeof(rmesh.boundsMin));
+			memcpy(rmesh.boundsMax, &mesh.boundsMax, sizeof(rmesh.boundsMax));
+			outRecord.meshes.push_back(rmesh);
+
+			if (!mesh.spriteRemap)
+				bones.insert(mesh.remaps.begin(), mesh.remaps.end());
+		}
+
+	outRecord.numSkinnedBones = static_cast<int>(bones.size());
+
+	for (auto &mat : staging.materials)
+	{
+		outRecord.materialHashes.push_back(mat.nameHash);
+
+		for (auto &tex : mat.textures)
+			if (!tex.empty())
+				outRecord.textures.emplace_back(tex.data(), tex.size());
+	}
+
+	return true;
+}
+
+size_t FindAssetFiles(const TCHAR *rootFolder, std::vector<TSTRING> &outFiles)
+{
+	std::vector<TSTRING> frontier(1, rootFolder);
+	size_t numFolders = 0;
+	const size_t firstFile = outFiles.size();
+
+	// Breadth first, every level of the tree is listed in parallel.
+	while (frontier.size())
+	{
+		const size_t numLevelFolders = frontier.size();
+		std::vector<std::vector<TSTRING>> subFolders(numLevelFolders);
+		std::vector<std::vector<TSTRING>> folderFiles(numLevelFolders);
+
+		RunParallel(numLevelFolders, [&](size_t f) { ListFolder(frontier[f], subFolders[f], folderFiles[f]); });
+
+		numFolders += numLevelFolders;
+		frontier.clear();
+
+		for (size_t f = 0; f < numLevelFolders; f++)
+		{
+			frontier.insert(frontier.end(), subFolders[f].begin(), subFolders[f].end());
+			outFiles.insert(outFiles.end(), folderFiles[f].begin(), folderFiles[f].end());
+		}
+	}
+
+	std::sort(outFiles.begin() + firstFile, outFiles.end());
+
+	return numFolders;
+}
+
+bool BuildAssetIndex(const TCHAR *rootFolder, const TCHAR *indexFileName, AssetScanStats &outStats, bool withBounds)
+{
+	std::vector<TSTRING> files;
+	outStats.numFolders += FindAssetFiles(rootFolder, files);
+	outStats.numFiles = files.size();
+
+	std::vector<AssetRecord> records(files.size());
+	std::vector<char> scanned(files.size());
+
+	RunParallel(files.size(), [&](size_t f) { scanned[f] = ScanAsset(files[f].c_str(), records[f], withBounds); });
+
+	AssetIndexWriter writer;
+
+	for (size_t f = 0; f < files.size(); f++)
+	{
+		if (scanned[f])
+			writer.Add(records[f]);
+		else
+			outStats.numFailed++;
+	}
+
+	outStats.numIndexed = writer.NumModels();
+
+	return writer.Save(indexFileName);
+}
+
+uint32_t AssetIndexWriter::AddString(const std::string &str)
+{
+	auto found = stringOffsets.find(str);
+
+	if (found != stringOffsets.end())
+		return found->second;
+
+	const uint32_t offset = static_cast<uint32_t>(strings.size());
+	strings.append(str.c_str(), str.size() + 1);
+	stringOffsets[str] = offset;
+
+	return offset;
+}
+
+static void Union(float *bmin, float *bmax, const float *otherMin, const float *otherMax)
+{
+	for (int a = 0; a < 3; a++)
+	{
+		if (otherMin[a] < bmin[a])
+			bmin[a] = otherMin[a];
+
+		if (otherMax[a] > bmax[a])
+			bmax[a] = otherMax[a];
+	}
+}
+
+void AssetIndexWriter::Add(const AssetRecord &record)
+{
+	const uint32_t modelIndex = static_cast<uint32_t>(models.size());
+	AssetIndexModel model = {};
+	model.path = AddString(record.path);
+	model.numLODs = record.numLODs;
+	model.numSkinnedBones = record.numSkinnedBones;
+	model.firstMesh = static_cast<uint32_t>(meshes.size());
+	model.numMeshes = static_cast<uint32_t>(record.meshes.size());
+	model.firstMaterial = static_cast<uint32_t>(materialRefs.size());
+	model.numMaterials = static_cast<uint32_t>(record.materialHashes.size());
+	model.firstTexture = static_cast<uint32_t>(textureRefs.size());
+	model.numTextures = static_cast<uint32_t>(record.textures.size());
+
+	if (record.hasBounds)
+		for (int a = 0; a < 3; a++)
+		{
+			model.boundsMin[a] = FLT_MAX;
+			model.boundsMax[a] = -FLT_MAX;
+		}
+	else
+		model.flags = AssetIndexModel::FLAG_NO_BOUNDS;
+
+	for (auto &rmesh : record.meshes)
+	{
+		AssetIndexMesh mesh = {};
+		memcpy(mesh.boundsMin, rmesh.boundsMin, sizeof(mesh.boundsMin));
+		memcpy(mesh.boundsMax, rmesh.boundsMax, sizeof(mesh.boundsMax));
+		mesh.model = modelIndex;
+		mesh.name = AddString(rmesh.name);
+		mesh.lodIndex = rmesh.lodIndex;
+		mesh.numVertices = rmesh.numVertices;
+		meshes.push_back(mesh);
+
+		model.numVertices += rmesh.numVertices;
+
+		if (record.hasBounds)
+			Union(model.boundsMin, model.boundsMax, rmesh.boundsMin, rmesh.boundsMax);
+	}
+
+	for (uint32_t hash : record.materialHashes)
+	{
+		materialRefs.push_back(hash);
+		materialLookups.push_back({ hash, modelIndex });
+	}
+
+	for (auto &tex : record.textures)
+	{
+		textureRefs.push_back(AddString(tex));
+		textureLookups.push_back({ ArchiveEntryHash(tex.c_str()), modelIndex });
+	}
+
+	models.push_back(model);
+}
+
+static void SortLookups(std::vector<AssetIndexLookup> &lookups)
+{
+	std::sort(lookups.begin(), lookups.end(), [](const AssetIndexLookup &l0, const AssetIndexLookup &l1)
+	{
+		return l0.hash < l1.hash || (l0.hash == l1.hash && l0.model < l1.model);
+	});
+
+	lookups.erase(std::unique(lookups.begin(), lookups.end(), [](const AssetIndexLookup &l0, const AssetIndexLookup &l1)
+	{
+		return l0.hash == l1.hash && l0.model == l1.model;
+	}), lookups.end());
+}
+
+template<class Type>
+static bool WriteSection(FILE *fle, const std::vector<Type> &section)
+{
+	return fwrite(section.data(), sizeof(Type), section.size(), fle) == section.size();
+}
+
+bool AssetIndexWriter::Save(const TCHAR *fileName)
+{
+	SortLookups(materialLookups);
+	SortLookups(textureLookups);
+
+	std::vector<uint32_t> meshesByVertices(meshes.size());
+
+	for (size_t m = 0; m < meshes.size(); m++)
+		meshesByVertices[m] = static_cast<uint32_t>(m);
+
+	std::stable_sort(meshesByVertices.begin(), meshesByVertices.end(),
+		[&](uint32_t m0, uint32_t m1) { return meshes[m0].numVertices > meshes[m1].numVertices; });
+
+	FILE *fle = _tfopen(fileName, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	AssetIndexHeader header = {};
+	header.magic = AssetIndexHeader::ID;
+	header.version = AssetIndexHeader::VERSION;
+	header.numModels = static_cast<uint32_t>(models.size());
+	header.numMeshes = static_cast<uint32_t>(meshes.size());
+	header.numMaterialRefs = static_cast<uint32_t>(materialRefs.size());
+	header.numTextureRefs = static_cast<uint32_t>(textureRefs.size());
+	header.numMaterialLookups = static_cast<uint32_t>(materialLookups.size());
+	header.numTextureLookups = static_cast<uint32_t>(textureLookups.size());
+	header.stringsSize = static_cast<uint32_t>(strings.size());
+
+	bool written = fwrite(&header, sizeof(header), 1, fle) == 1;
+	written = written && WriteSection(fle, models);
+	written = written && WriteSection(fle, meshes);
+	written = written && WriteSection(fle, meshesByVertices);
+	written = written && WriteSection(fle, materialRefs);
+	written = written && WriteSection(fle, textureRefs);
+	written = written && WriteSection(fle, materialLookups);
+	written = written && WriteSection(fle, textureLookups);
+	written = written && fwrite(strings.data(), 1, strings.size(), fle) == strings.size();
+	fclose(fle);
+
+	return written;
+}
+
+AssetIndex::AssetIndex() : header(nullptr), models(nullptr), meshes(nullptr), meshesByVertices(nullptr), materialRefs(nullptr),
+	textureRefs(nullptr), materialLookups(nullptr), textureLookups(nullptr), strings(nullptr) {}
+
+bool AssetIndex::Open(const TCHAR *fileName)
+{
+	header = nullptr;
+
+	if (!file.Open(fileName) || file.Size() < sizeof(AssetIndexHeader))
+		return false;
+
+	const AssetIndexHeader *hdr = reinterpret_cast<const AssetIndexHeader *>(file.Data());
+
+	if (hdr->magic != AssetIndexHeader::ID || hdr->version != AssetIndexHeader::VERSION)
+		return false;
+
+	const uint64_t expectedSize = sizeof(AssetIndexHeader) + static_cast<uint64_t>(hdr->numModels) * sizeof(AssetIndexModel) +
+		static_cast<uint64_t>(hdr->numMeshes) * (sizeof(AssetIndexMesh) + sizeof(uint32_t)) +
+		(static_cast<uint64_t>(hdr->numMaterialRefs) + hdr->numTextureRefs) * sizeof(uint32_t) +
+		(static_cast<uint64_t>(hdr->numMaterialLookups) + hdr->numTextureLookups) * sizeof(AssetIndexLookup) + hdr->stringsSize;
+
+	if (expectedSize != file.Size() || (hdr->stringsSize && file.Data()[file.Size() - 1]))
+		return false;
+
+	const char *cursor = file.Data() + sizeof(AssetIndexHeader);
+
+	models = reinterpret_cast<const AssetIndexModel *>(cursor);
+	cursor += hdr->numModels * sizeof(AssetIndexModel);
+	meshes = reinterpret_cast<const AssetIndexMesh *>(cursor);
+	cursor += hdr->numMeshes * sizeof(AssetIndexMesh);
+	meshesByVertices = reinterpret_cast<const uint32_t *>(cursor);
+	cursor += hdr->numMeshes * sizeof(uint32_t);
+	materialRefs = reinterpret_cast<const uint32_t *>(cursor);
+	cursor += hdr->numMaterialRefs * sizeof(uint32_t);
+	textureRefs = reinterpret_cast<const uint32_t *>(cursor);
+	cursor += hdr->numTextureRefs * sizeof(uint32_t);
+	materialLookups = reinterpret_cast<const AssetIndexLookup *>(cursor);
+	cursor += hdr->numMaterialLookups * sizeof(AssetIndexLookup);
+	textureLookups = reinterpret_cast<const AssetIndexLookup *>(cursor);
+	cursor += hdr->numTextureLookups * sizeof(AssetIndexLookup);
+	strings = cursor;
+	header = hdr;
+
+	return true;
+}
+
+static const AssetIndexLookup *FindLookups(const AssetIndexLookup *lookups, size_t numLookups, uint32_t hash)
+{
+	return std::lower_bound(lookups, lookups + numLookups, hash, [](const AssetIndexLookup &l, uint32_t h) { return l.hash < h; });
+}
+
+// Same rules as ArchiveEntryHash, case insensitive and either slash.
+static bool SamePath(const char *path0, const char *path1)
+{
+	for (; *path0 && *path1; path0++, path1++)
+	{
+		const char c0 = *path0 == '\\' ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(*path0)));
+		const char c1 = *path1 == '\\' ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(*path1)));
+
+		if (c0 != c1)
+			return false;
+	}
+
+	return *path0 == *path1;
+}
+
+void AssetIndex::ModelsUsingTexture(const char *path, std::vector<uint32_t> &outModels) const
+{
+	if (!header)
+		return;
+
+	const uint32_t hash = ArchiveEntryHash(path);
+	const AssetIndexLookup *end = textureLookups + header->numTextureLookups;
+
+	// Lookups are keyed by 32 bit hash only, colliding paths are told apart by model's own texture strings.
+	for (const AssetIndexLookup *found = FindLookups(textureLookups, header->numTextureLookups, hash); found != end && found->hash == hash; found++)
+	{
+		const AssetIndexModel &model = models[found->model];
+		const uint32_t *textures = Textures(model);
+
+		for (uint32_t t = 0; t < model.numTextures; t++)
+			if (SamePath(String(textures[t]), path))
+			{
+				outModels.push_back(found->model);
+				break;
+			}
+	}
+}
+
+void AssetIndex::ModelsUsingMaterial(uint32_t nameHash, std::vector<uint32_t> &outModels) const
+{
+	if (!header)
+		return;
+
+	const AssetIndexLookup *end = materialLookups + header->numMaterialLookups;
+
+	for (const AssetIndexLookup *found = FindLookups(materialLookups, header->numMaterialLookups, nameHash); found != end && found->hash == nameHash; found++)
+		outModels.push_back(found->model);
+}
+
+size_t AssetIndex::MeshesAbove(uint32_t numVertices, const uint32_t *&outMeshes) const
+{
+	outMeshes = meshesByVertices;
+
+	if (!header)
+		return 0;
+
+	const uint32_t *end = meshesByVertices + header->numMeshes;
+	const uint32_t *found = std::partition_point(meshesByVertices, end, [&](uint32_t m) { return meshes[m].numVertices > numVertices; });
+
+	return found - meshesByVertices;
+}
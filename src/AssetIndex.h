@@ -0,0 +1,192 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ADFLoader.h"
+#include "datas/esstring.h"
+
+// Model metadata index, read straight from a mapped file.
+// Sections follow each other in this order, strings are null terminated and addressed by offset.
+//
+// AssetIndexHeader
+// AssetIndexModel[numModels]
+// AssetIndexMesh[numMeshes]
+// uint32_t meshesByVertices[numMeshes], mesh indices sorted by vertex count, largest first
+// uint32_t materialRefs[numMaterialRefs], material name hashes of every model
+// uint32_t textureRefs[numTextureRefs], texture path string offsets of every model
+// AssetIndexLookup materialLookups[numMaterialLookups], sorted by hash
+// AssetIndexLookup textureLookups[numTextureLookups], sorted by ArchiveEntryHash of path
+// char strings[stringsSize]
+
+struct AssetIndexHeader
+{
+	static const uint32_t ID = 0x58444941; // AIDX
+	static const uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numModels;
+	uint32_t numMeshes;
+	uint32_t numMaterialRefs;
+	uint32_t numTextureRefs;
+	uint32_t numMaterialLookups;
+	uint32_t numTextureLookups;
+	uint32_t stringsSize;
+	uint32_t reserved;
+};
+
+struct AssetIndexModel
+{
+	// Scanned without bounds, bounds of the model and its meshes are zero.
+	static const uint32_t FLAG_NO_BOUNDS = 1;
+
+	uint64_t numVertices;
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t path;
+	uint32_t numLODs;
+	uint32_t numSkinnedBones;
+	uint32_t firstMesh;
+	uint32_t numMeshes;
+	uint32_t firstMaterial;
+	uint32_t numMaterials;
+	uint32_t firstTexture;
+	uint32_t numTextures;
+	uint32_t flags;
+};
+
+struct AssetIndexMesh
+{
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t model;
+	uint32_t name;
+	int32_t lodIndex;
+	uint32_t numVertices;
+};
+
+struct AssetIndexLookup
+{
+	uint32_t hash;
+	uint32_t model;
+};
+
+// Scanned metadata of a single model file, bounds are in Apex units, Max axes.
+struct AssetRecord
+{
+	struct Mesh
+	{
+		std::string name;
+		int lodIndex;
+		uint32_t numVertices;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	std::string path;
+	int numLODs;
+	// Unique bone indices referenced by remap tables of skinned meshes over every LOD, not skeleton size.
+	// Bones without weights and bones of sprite remapped meshes are not counted.
+	int numSkinnedBones;
+	std::vector<Mesh> meshes;
+	std::vector<uint32_t> materialHashes;
+	std::vector<std::string> textures;
+	bool hasBounds;
+
+	AssetRecord() : numLODs(0), numSkinnedBones(0), hasBounds(true) {}
+};
+
+class AssetIndexWriter
+{
+	std::vector<AssetIndexModel> models;
+	std::vector<AssetIndexMesh> meshes;
+	std::vector<uint32_t> materialRefs;
+	std::vector<uint32_t> textureRefs;
+	std::vector<AssetIndexLookup> materialLookups;
+	std::vector<AssetIndexLookup> textureLookups;
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> stringOffsets;
+
+	uint32_t AddString(const std::string &str);
+
+public:
+	void Add(const AssetRecord &record);
+	bool Save(const TCHAR *fileName);
+
+	size_t NumModels() const { return models.size(); }
+};
+
+class AssetIndex
+{
+	MappedFile file;
+	const AssetIndexHeader *header;
+	const AssetIndexModel *models;
+	const AssetIndexMesh *meshes;
+	const uint32_t *meshesByVertices;
+	const uint32_t *materialRefs;
+	const uint32_t *textureRefs;
+	const AssetIndexLookup *materialLookups;
+	const AssetIndexLookup *textureLookups;
+	const char *strings;
+
+public:
+	AssetIndex();
+
+	// Validates section sizes, nothing is copied.
+	bool Open(const TCHAR *fileName);
+
+	size_t NumModels() const { return header ? header->numModels : 0; }
+	size_t NumMeshes() const { return header ? header->numMeshes : 0; }
+	const AssetIndexModel &Model(size_t index) const { return models[index]; }
+	const AssetIndexMesh &Mesh(size_t index) const { return meshes[index]; }
+	const uint32_t *MaterialHashes(const AssetIndexModel &model) const { return materialRefs + model.firstMaterial; }
+	const uint32_t *Textures(const AssetIndexModel &model) const { return textureRefs + model.firstTexture; }
+	const char *String(uint32_t offset) const { return strings + offset; }
+
+	// Texture path is matched case insensitive and with either slash, models are sorted and unique.
+	void ModelsUsingTexture(const char *path, std::vector<uint32_t> &outModels) const;
+	void ModelsUsingMaterial(uint32_t nameHash, std::vector<uint32_t> &outModels) const;
+
+	// Returns number of meshes with more than numVertices, outMeshes points to them, largest first.
+	size_t MeshesAbove(uint32_t numVertices, const uint32_t *&outMeshes) const;
+};
+
+struct AssetScanStats
+{
+	size_t numFolders;
+	size_t numFiles;
+	size_t numIndexed;
+	size_t numFailed;
+
+	AssetScanStats() : numFolders(0), numFiles(0), numIndexed(0), numFailed(0) {}
+};
+
+// Appends sorted modelc, rbm, rbn and vmodc files found under rootFolder, returns number of folders walked.
+size_t FindAssetFiles(const TCHAR *rootFolder, std::vector<TSTRING> &outFiles);
+
+// Decodes only positions of a modelc, rbm, rbn or vmodc file, bounds can't be had from headers alone.
+// Without bounds, no vertex stream is decoded at all.
+// Either way IADF still reads and keeps every buffer of the file, so scan I/O and ADF memory match a full load.
+bool ScanAsset(const TCHAR *fileName, AssetRecord &outRecord, bool withBounds = true);
+
+// Walks rootFolder and scans found model files in parallel on taskScheduler, then writes the index.
+bool BuildAssetIndex(const TCHAR *rootFolder, const TCHAR *indexFileName, AssetScanStats &outStats, bool withBounds = true);
@@ -16,8 +16,11 @@
 */
 
 #include "ApexMax.h"
+#include <IPathConfigMgr.h>
 #include <gdiplus.h>
 #include "datas/MasterPrinter.hpp"
+#include "LogSink.h"
+#include "TaskScheduler.h"
 
 ClassDesc2* GetApexImpDesc();
 
@@ -25,6 +28,7 @@ HINSTANCE hInstance;
 int controlsInit = FALSE;
 Gdiplus::GdiplusStartupInput gdiplusStartupInput;
 ULONG_PTR gdiplusToken;
+UINT_PTR logTimer;
 
 // This function is called by Windows when the DLL is loaded.  This 
 // function may also be called many times during time critical operations
@@ -77,14 +81,24 @@ __declspec( dllexport ) ULONG LibVersion()
 }
 
 void PrintLog(TCHAR* msg)
+{
+	logSink.Push(msg);
+}
+
+void PrintListener(const TCHAR *msg)
 {
 	if (!IsWindowVisible(the_listener_window) || IsIconic(the_listener_window))
 		show_listener();
 
-	mprintf(msg);
+	mprintf(_T("%s"), msg);
 	mflush();
 }
 
+static void CALLBACK LogTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+	logSink.Drain();
+}
+
 // This function is called once, right after your plugin has been loaded by 3ds Max. 
 // Perform one-time plugin initialization in this method.
 // Return TRUE if you deem your plugin successfully loaded, or FALSE otherwise. If 
@@ -93,6 +107,11 @@ void PrintLog(TCHAR* msg)
 __declspec( dllexport ) int LibInitialize(void)
 {
 	printer.AddPrinterFunction(PrintLog);
+	logSink.SetOutput(PrintListener);
+	TSTRING cfgpath = IPathConfigMgr::GetPathConfigMgr()->GetDir(APP_PLUGCFG_DIR);
+	cfgpath.append(_T("\\ApexImpSettings.ini"));
+	taskScheduler = new TaskScheduler(GetPrivateProfileInt(_T("Advanced"), _T("MaxWorkers"), 0, cfgpath.c_str()));
+	logTimer = SetTimer(nullptr, 0, 500, LogTimerProc);
 	Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
 	return TRUE;
 }
@@ -102,6 +121,11 @@ __declspec( dllexport ) int LibInitialize(void)
 // The system doesn't pay attention to a return value.
 __declspec( dllexport ) int LibShutdown(void)
 {
+	KillTimer(nullptr, logTimer);
+	delete taskScheduler;
+	taskScheduler = nullptr;
+	logSink.Drain();
+	logSink.SetOutput(nullptr);
 	Gdiplus::GdiplusShutdown(gdiplusToken);
 	return TRUE;
 }
@@ -0,0 +1,723 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "GltfExport.h"
+#include "datas/esstring.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+enum GltfComponent
+{
+	GltfComponent_UByte = 5121,
+	GltfComponent_UShort = 5123,
+	GltfComponent_Float = 5126
+};
+
+enum GltfTarget
+{
+	GltfTarget_None = 0,
+	GltfTarget_Vertices = 34962,
+	GltfTarget_Indices = 34963
+};
+
+template<class String>
+static void AppendJSONString(std::string &json, const String &str)
+{
+	json.push_back('"');
+
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			json.push_back('\\');
+			json.push_back(c);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			json.append(escaped);
+		}
+		else
+			json.push_back(c);
+	}
+
+	json.push_back('"');
+}
+
+static void AppendJSONFloat(std::string &json, float value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.9g", value);
+	json.append(buffer);
+}
+
+static void AppendSeparator(std::string &json)
+{
+	if (!json.empty())
+		json.push_back(',');
+}
+
+// Buffer is a list of segments pointing into staging, nothing is copied until streamed into file.
+// Data that needs conversion lives in scratch, deque keeps it in place while it grows.
+class GltfWriter
+{
+	struct Segment
+	{
+		const void *data;
+		size_t size;
+		size_t offset;
+	};
+
+	std::vector<Segment> segments;
+	std::deque<std::vector<char>> scratch;
+
+public:
+	std::string meshes;
+	std::string materials;
+	std::string accessors;
+	std::string bufferViews;
+	int numMeshes;
+	int numAccessors;
+	int numBufferViews;
+	size_t bufferSize;
+	size_t copiedSize;
+
+	GltfWriter() : numMeshes(0), numAccessors(0), numBufferViews(0), bufferSize(0), copiedSize(0) {}
+
+	template<class Type>
+	Type *Scratch(size_t count)
+	{
+		scratch.emplace_back(count * sizeof(Type));
+		copiedSize += count * sizeof(Type);
+
+		return reinterpret_cast<Type *>(scratch.back().data());
+	}
+
+	// Views are 4 byte aligned, as glTF requires for vertex attributes.
+	int AddBufferView(const void *data, size_t size, int stride, GltfTarget target)
+	{
+		Segment seg = { data, size, bufferSize };
+		segments.push_back(seg);
+		bufferSize += (size + 3) & ~static_cast<size_t>(3);
+
+		char buffer[128];
+		snprintf(buffer, sizeof(buffer), "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu", seg.offset, size);
+		AppendSeparator(bufferViews);
+		bufferViews.append(buffer);
+
+		if (stride)
+		{
+			snprintf(buffer, sizeof(buffer), ",\"byteStride\":%i", stride);
+			bufferViews.append(buffer);
+		}
+
+		if (target)
+		{
+			snprintf(buffer, sizeof(buffer), ",\"target\":%i", target);
+			bufferViews.append(buffer);
+		}
+
+		bufferViews.push_back('}');
+
+		return numBufferViews++;
+	}
+
+	int AddAccessor(int bufferView, size_t byteOffset, GltfComponent component, size_t count, const char *type,
+		const float *minValues = nullptr, const float *maxValues = nullptr, int numValues = 0)
+	{
+		char buffer[160];
+		snprintf(buffer, sizeof(buffer), "{\"bufferView\":%i,\"byteOffset\":%zu,\"componentType\":%i,\"count\":%zu,\"type\":\"%s\"",
+			bufferView, byteOffset, component, count, type);
+		AppendSeparator(accessors);
+		accessors.append(buffer);
+
+		if (minValues)
+		{
+			accessors.append(",\"min\":[");
+
+			for (int v = 0; v < numValues; v++)
+			{
+				if (v)
+					accessors.push_back(',');
+
+				AppendJSONFloat(accessors, minValues[v]);
+			}
+
+			accessors.append("],\"max\":[");
+
+			for (int v = 0; v < numValues; v++)
+			{
+				if (v)
+					accessors.push_back(',');
+
+				AppendJSONFloat(accessors, maxValues[v]);
+			}
+
+			accessors.push_back(']');
+		}
+
+		accessors.push_back('}');
+
+		return numAccessors++;
+	}
+
+	int AddVectors(const Vector *data, size_t count, bool bounds)
+	{
+		const int view = AddBufferView(data, count * sizeof(Vector), 0, GltfTarget_Vertices);
+
+		if (!bounds)
+			return AddAccessor(view, 0, GltfComponent_Float, count, "VEC3");
+
+		float bmin[] = { FLT_MAX, FLT_MAX, FLT_MAX }, bmax[] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		const float *xyz = &data->X;
+
+		for (size_t v = 0; v < count; v++, xyz += 3)
+			for (int a = 0; a < 3; a++)
+			{
+				bmin[a] = xyz[a] < bmin[a] ? xyz[a] : bmin[a];
+				bmax[a] = xyz[a] > bmax[a] ? xyz[a] : bmax[a];
+			}
+
+		return AddAccessor(view, 0, GltfComponent_Float, count, "VEC3", bmin, bmax, 3);
+	}
+
+	bool WriteBuffer(FILE *fle) const
+	{
+		static const char padding[4] = {};
+
+		for (auto &s : segments)
+		{
+			const size_t padded = (s.size + 3) & ~static_cast<size_t>(3);
+
+			if (fwrite(s.data, 1, s.size, fle) != s.size || fwrite(padding, 1, padded - s.size, fle) != padded - s.size)
+				return false;
+		}
+
+		return true;
+	}
+};
+
+struct GltfBones
+{
+	std::map<int, int> nodes; // bone ID to node index, filled after meshes
+	std::vector<int> ids;
+
+	void Add(int boneID)
+	{
+		if (nodes.emplace(boneID, 0).second)
+			ids.push_back(boneID);
+	}
+};
+
+static void AppendAttribute(std::string &attributes, const char *name, int accessor)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "\"%s\":%i", name, accessor);
+	AppendSeparator(attributes);
+	attributes.append(buffer);
+}
+
+// Returns mesh index or -1 for meshes without faces.
+static int ExportMesh(GltfWriter &wr, const MeshStaging &mesh, const std::map<uint32_t, int> &materials, GltfBones &bones,
+	std::vector<int> &outSkinJoints, int &outNumTargets)
+{
+	if (!mesh.Valid() || mesh.culled || mesh.faces.empty() || mesh.positions.size() != static_cast<size_t>(mesh.numVertices))
+		return -1;
+
+	const size_t numVerts = mesh.numVertices;
+	std::string attributes;
+	AppendAttribute(attributes, "POSITION", wr.AddVectors(mesh.positions.data(), numVerts, true));
+
+	if (mesh.normals.size() == numVerts)
+		AppendAttribute(attributes, "NORMAL", wr.AddVectors(mesh.normals.data(), numVerts, false));
+
+	// Max convention flips V, it goes back to top left origin.
+	int numUVSets = 0;
+
+	for (auto &channel : mesh.uvChannels)
+	{
+		if (channel.size() != numVerts)
+			continue;
+
+		float *uvs = wr.Scratch<float>(numVerts * 2);
+
+		for (size_t v = 0; v < numVerts; v++)
+		{
+			uvs[v * 2] = channel[v].X;
+			uvs[v * 2 + 1] = 1.0f - channel[v].Y;
+		}
+
+		const int view = wr.AddBufferView(uvs, numVerts * 2 * sizeof(float), 0, GltfTarget_Vertices);
+		const std::string name = "TEXCOORD_" + std::to_string(numUVSets++);
+		AppendAttribute(attributes, name.c_str(), wr.AddAccessor(view, 0, GltfComponent_Float, numVerts, "VEC2"));
+	}
+
+	if (mesh.colors.size() == numVerts)
+		AppendAttribute(attributes, "COLOR_0", wr.AddVectors(mesh.colors.data(), numVerts, false));
+
+	if (mesh.alpha.size() == numVerts)
+	{
+		const int view = wr.AddBufferView(mesh.alpha.data(), numVerts * sizeof(float), 0, GltfTarget_Vertices);
+		AppendAttribute(attributes, "_ALPHA", wr.AddAccessor(view, 0, GltfComponent_Float, numVerts, "SCALAR"));
+	}
+
+	const SkinStaging &skin = mesh.skin;
+	const bool skinned = !mesh.spriteRemap && !mesh.morph.Valid() && mesh.remaps.size() > 1 && skin.Valid() &&
+		skin.indices.size() == numVerts * skin.numInfluences && skin.weights.size() == numVerts * skin.numInfluences;
+
+	if (skinned)
+	{
+		// Influences go in sets of 4, counts that don't divide get padded with zero weights.
+		const int numInfluences = skin.numInfluences;
+		const int numSets = (numInfluences + 3) / 4;
+		const int stride = numSets * 4;
+		const uchar *indices = skin.indices.data();
+		const float *weights = skin.weights.data();
+
+		if (stride != numInfluences)
+		{
+			uchar *paddedIndices = wr.Scratch<uchar>(numVerts * stride);
+			float *paddedWeights = wr.Scratch<float>(numVerts * stride);
+
+			for (size_t v = 0; v < numVerts; v++)
+				for (int i = 0; i < stride; i++)
+				{
+					paddedIndices[v * stride + i] = i < numInfluences ? indices[v * numInfluences + i] : 0;
+					paddedWeights[v * stride + i] = i < numInfluences ? weights[v * numInfluences + i] : 0.0f;
+				}
+
+			indices = paddedIndices;
+			weights = paddedWeights;
+		}
+
+		const int indicesView = wr.AddBufferView(indices, numVerts * stride, stride, GltfTarget_Vertices);
+		const int weightsView = wr.AddBufferView(weights, numVerts * stride * sizeof(float), stride * static_cast<int>(sizeof(float)),
+			GltfTarget_Vertices);
+
+		for (int s = 0; s < numSets; s++)
+		{
+			const std::string joints = "JOINTS_" + std::to_string(s), weightsName = "WEIGHTS_" + std::to_string(s);
+			AppendAttribute(attributes, joints.c_str(), wr.AddAccessor(indicesView, s * 4, GltfComponent_UByte, numVerts, "VEC4"));
+			AppendAttribute(attributes, weightsName.c_str(),
+				wr.AddAccessor(weightsView, s * 4 * sizeof(float), GltfComponent_Float, numVerts, "VEC4"));
+		}
+
+		for (int b : mesh.remaps)
+		{
+			bones.Add(b);
+			outSkinJoints.push_back(b);
+		}
+	}
+
+	// Deform morph is the first target, control points add a target per channel.
+	std::string targets, targetNames;
+	outNumTargets = 0;
+
+	if (!mesh.spriteRemap && mesh.morph.Valid() && mesh.morph.deltas.size() == numVerts)
+	{
+		const MorphStaging &morph = mesh.morph;
+		targets.append("{\"POSITION\":" + std::to_string(wr.AddVectors(morph.deltas.data(), numVerts, true)) + "}");
+		targetNames.append("\"Deform\"");
+		outNumTargets++;
+
+		if (morph.controlChannels.size() == numVerts && morph.controlWeights.size() == numVerts)
+		{
+			const size_t numChannels = mesh.remaps.size();
+			std::vector<Vector *> channels(numChannels);
+
+			for (size_t c = 0; c < numChannels; c++)
+				if (mesh.remaps[c] > 0)
+				{
+					channels[c] = wr.Scratch<Vector>(numVerts);
+					memset(channels[c], 0, numVerts * sizeof(Vector));
+				}
+
+			for (size_t v = 0; v < numVerts; v++)
+			{
+				const Vector &delta = morph.deltas[v];
+				const UIVector4 &vertChannels = morph.controlChannels[v];
+				const Vector4 &vertWeights = morph.controlWeights[v];
+
+				for (int c = 0; c < 4; c++)
+				{
+					const uint32_t channel = vertChannels[c];
+
+					if (channel >= numChannels || !channels[channel])
+						continue;
+
+					Vector &target = channels[channel][v];
+					target.X += delta.X * vertWeights[c];
+					target.Y += delta.Y * vertWeights[c];
+					target.Z += delta.Z * vertWeights[c];
+				}
+			}
+
+			for (size_t c = 0; c < numChannels; c++)
+				if (channels[c])
+				{
+					targets.append(",{\"POSITION\":" + std::to_string(wr.AddVectors(channels[c], numVerts, true)) + "}");
+					targetNames.append(",\"cp" + std::to_string(mesh.remaps[c]) + "\"");
+					outNumTargets++;
+				}
+		}
+	}
+
+	const int indicesView = wr.AddBufferView(mesh.faces.data(), mesh.faces.size() * sizeof(USVector), 0, GltfTarget_Indices);
+	std::string primitives;
+	size_t firstFace = 0;
+
+	for (size_t s = 0; s < mesh.subMeshNumFaces.size() && firstFace < mesh.faces.size(); s++)
+	{
+		size_t numFaces = mesh.subMeshNumFaces[s];
+		numFaces = firstFace + numFaces > mesh.faces.size() ? mesh.faces.size() - firstFace : numFaces;
+
+		if (!numFaces)
+			continue;
+
+		const int accessor = wr.AddAccessor(indicesView, firstFace * sizeof(USVector), GltfComponent_UShort, numFaces * 3, "SCALAR");
+		AppendSeparator(primitives);
+		primitives.append("{\"attributes\":{" + attributes + "},\"indices\":" + std::to_string(accessor));
+
+		if (s < mesh.subMeshNameHashes.size())
+		{
+			auto found = materials.find(mesh.subMeshNameHashes[s]);
+
+			if (found != materials.end())
+				primitives.append(",\"material\":" + std::to_string(found->second));
+		}
+
+		if (outNumTargets)
+			primitives.append(",\"targets\":[" + targets + "]");
+
+		primitives.push_back('}');
+		firstFace += numFaces;
+	}
+
+	if (primitives.empty())
+		return -1;
+
+	AppendSeparator(wr.meshes);
+	wr.meshes.append("{\"name\":");
+	AppendJSONString(wr.meshes, mesh.name);
+	wr.meshes.append(",\"primitives\":[" + primitives + "]");
+
+	if (outNumTargets)
+	{
+		wr.meshes.append(",\"weights\":[");
+
+		for (int t = 0; t < outNumTargets; t++)
+			wr.meshes.append(t ? ",0" : "0");
+
+		wr.meshes.append("],\"extras\":{\"targetNames\":[" + targetNames + "]}");
+	}
+
+	wr.meshes.push_back('}');
+
+	return wr.numMeshes++;
+}
+
+static void AppendMaterial(std::string &json, const MaterialStaging &mat)
+{
+	AppendSeparator(json);
+	json.append("{\"name\":");
+	AppendJSONString(json, mat.name);
+	json.append(",\"extras\":{\"apexNameHash\":" + std::to_string(mat.nameHash) + ",\"apexAttributesHash\":" +
+		std::to_string(mat.attributesHash) + ",\"textures\":[");
+
+	for (size_t t = 0; t < mat.textures.size(); t++)
+	{
+		if (t)
+			json.push_back(',');
+
+		AppendJSONString(json, mat.textures[t]);
+	}
+
+	json.append("]}}");
+}
+
+static bool WriteGLB(const TCHAR *fileName, const std::string &json, const GltfWriter &wr)
+{
+	FILE *fle = _tfopen(fileName, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	setvbuf(fle, nullptr, _IOFBF, 1 << 20);
+
+	const uint32_t jsonSize = static_cast<uint32_t>((json.size() + 3) & ~static_cast<size_t>(3));
+	const uint32_t binSize = static_cast<uint32_t>(wr.bufferSize);
+	const uint32_t header[] = { 0x46546C67, 2, 12 + 8 + jsonSize + 8 + binSize }; // glTF
+	const uint32_t jsonChunk[] = { jsonSize, 0x4E4F534A }; // JSON
+	const uint32_t binChunk[] = { binSize, 0x004E4942 }; // BIN
+
+	bool written = fwrite(header, sizeof(header), 1, fle) == 1 && fwrite(jsonChunk, sizeof(jsonChunk), 1, fle) == 1 &&
+		fwrite(json.data(), 1, json.size(), fle) == json.size() && fwrite("   ", 1, jsonSize - json.size(), fle) == jsonSize - json.size() &&
+		fwrite(binChunk, sizeof(binChunk), 1, fle) == 1 && wr.WriteBuffer(fle);
+
+	written = !fclose(fle) && written;
+
+	return written;
+}
+
+static bool WriteBin(const TCHAR *fileName, const GltfWriter &wr)
+{
+	FILE *fle = _tfopen(fileName, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	setvbuf(fle, nullptr, _IOFBF, 1 << 20);
+
+	bool written = wr.WriteBuffer(fle);
+	written = !fclose(fle) && written;
+
+	return written;
+}
+
+bool ExportGltf(const ModelStaging &staging, const TCHAR *fileName, GltfExportStats &outStats)
+{
+	const TSTRING filePath = fileName;
+	const size_t separator = filePath.find_last_of(_T("/\\"));
+	const size_t dot = filePath.find_last_of('.');
+	const bool hasExtension = dot != TSTRING::npos && (separator == TSTRING::npos || dot > separator);
+	const TSTRING basePath = hasExtension ? filePath.substr(0, dot) : filePath;
+	const bool binary = hasExtension && !_tcsicmp(filePath.c_str() + dot, _T(".glb"));
+	const std::string modelName = static_cast<std::string>(esString(basePath.substr(separator == TSTRING::npos ? 0 : separator + 1)));
+
+	GltfWriter wr;
+	std::map<uint32_t, int> materials;
+
+	for (auto &mat : staging.materials)
+		if (materials.emplace(mat.nameHash, static_cast<int>(materials.size())).second)
+			AppendMaterial(wr.materials, mat);
+
+	// Node 0 is root, LOD and mesh nodes follow, bones go last once every skin is known.
+	// Only the highest detail LOD is a child of root, the others hang off it through MSFT_lod.
+	struct MeshNode
+	{
+		int mesh;
+		int skin;
+		int bone;
+		std::string name;
+	};
+
+	struct LODNode
+	{
+		int lodIndex;
+		std::vector<MeshNode> meshes;
+	};
+
+	std::vector<LODNode> lods;
+	std::vector<std::vector<int>> skinJoints;
+	std::map<std::vector<int>, int> skinIndices;
+	GltfBones bones;
+
+	for (auto &lod : staging.lods)
+	{
+		LODNode lnode;
+		lnode.lodIndex = lod.lodIndex;
+
+		for (auto &mesh : lod.meshes)
+		{
+			std::vector<int> joints;
+			int numTargets = 0;
+			const int meshIndex = ExportMesh(wr, mesh, materials, bones, joints, numTargets);
+
+			if (meshIndex < 0)
+				continue;
+
+			MeshNode mnode = { meshIndex, -1, -1, mesh.name.c_str() };
+
+			// Meshes of a LOD mostly share their bone palette, so they share a skin too.
+			if (joints.size())
+			{
+				auto found = skinIndices.emplace(joints, static_cast<int>(skinJoints.size()));
+
+				if (found.second)
+					skinJoints.push_back(joints);
+
+				mnode.skin = found.first->second;
+			}
+			else if (!mesh.spriteRemap && !mesh.morph.Valid() && mesh.remaps.size() == 1)
+			{
+				mnode.bone = mesh.remaps[0];
+				bones.Add(mnode.bone);
+			}
+
+			lnode.meshes.push_back(mnode);
+			outStats.numMeshes++;
+			outStats.numTargets += numTargets;
+		}
+
+		lods.push_back(lnode);
+	}
+
+	int numNodes = 1;
+	std::vector<int> lodNodes;
+	std::vector<size_t> lodOrder;
+
+	for (auto &l : lods)
+	{
+		lodOrder.push_back(lodNodes.size());
+		lodNodes.push_back(numNodes);
+		numNodes += 1 + static_cast<int>(l.meshes.size());
+	}
+
+	// Lower LOD index means more detail.
+	std::stable_sort(lodOrder.begin(), lodOrder.end(), [&](size_t l0, size_t l1) { return lods[l0].lodIndex < lods[l1].lodIndex; });
+
+	for (int id : bones.ids)
+		bones.nodes[id] = numNodes++;
+
+	outStats.numJoints = static_cast<int>(bones.ids.size());
+
+	// Apex Y up was turned into Max Z up during staging, -90 degrees around X turns it back.
+	std::string nodes = "{\"name\":";
+	AppendJSONString(nodes, modelName);
+	nodes.append(",\"rotation\":[-0.707106781,0,0,0.707106781]");
+	std::string children;
+
+	if (lodOrder.size())
+		children.append(std::to_string(lodNodes[lodOrder[0]]));
+
+	for (int id : bones.ids)
+	{
+		AppendSeparator(children);
+		children.append(std::to_string(bones.nodes[id]));
+	}
+
+	if (children.size())
+		nodes.append(",\"children\":[" + children + "]");
+
+	nodes.push_back('}');
+
+	for (size_t ld = 0; ld < lods.size(); ld++)
+	{
+		const LODNode &l = lods[ld];
+		const int nodeIndex = lodNodes[ld];
+		nodes.append(",{\"name\":\"LOD" + std::to_string(l.lodIndex) + "\"");
+
+		if (l.meshes.size())
+		{
+			nodes.append(",\"children\":[");
+
+			for (size_t m = 0; m < l.meshes.size(); m++)
+				nodes.append((m ? "," : "") + std::to_string(nodeIndex + 1 + m));
+
+			nodes.push_back(']');
+		}
+
+		if (ld == lodOrder[0] && lodOrder.size() > 1)
+		{
+			nodes.append(",\"extensions\":{\"MSFT_lod\":{\"ids\":[");
+
+			for (size_t o = 1; o < lodOrder.size(); o++)
+				nodes.append((o > 1 ? "," : "") + std::to_string(lodNodes[lodOrder[o]]));
+
+			nodes.append("]}}");
+		}
+
+		nodes.push_back('}');
+
+		for (auto &m : l.meshes)
+		{
+			nodes.append(",{\"name\":");
+			AppendJSONString(nodes, m.name);
+			nodes.append(",\"mesh\":" + std::to_string(m.mesh));
+
+			if (m.skin >= 0)
+				nodes.append(",\"skin\":" + std::to_string(m.skin));
+
+			// Rigid meshes are linked to a single bone, it's kept as a hint, node can have one parent only.
+			if (m.bone >= 0)
+				nodes.append(",\"extras\":{\"apexBone\":" + std::to_string(m.bone) + "}");
+
+			nodes.push_back('}');
+		}
+	}
+
+	for (int id : bones.ids)
+		nodes.append(",{\"name\":\"Bone" + std::to_string(id) + "\"}");
+
+	std::string skins;
+
+	for (size_t s = 0; s < skinJoints.size(); s++)
+	{
+		skins.append(s ? ",{\"joints\":[" : "{\"joints\":[");
+
+		for (size_t j = 0; j < skinJoints[s].size(); j++)
+			skins.append((j ? "," : "") + std::to_string(bones.nodes[skinJoints[s][j]]));
+
+		skins.append("]}");
+	}
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"ApexMax\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[" + nodes + "]";
+
+	if (lods.size() > 1)
+		json.append(",\"extensionsUsed\":[\"MSFT_lod\"]");
+
+	if (wr.numMeshes)
+		json.append(",\"meshes\":[" + wr.meshes + "]");
+
+	if (skins.size())
+		json.append(",\"skins\":[" + skins + "]");
+
+	if (wr.materials.size())
+		json.append(",\"materials\":[" + wr.materials + "]");
+
+	if (wr.numAccessors)
+		json.append(",\"accessors\":[" + wr.accessors + "],\"bufferViews\":[" + wr.bufferViews + "]");
+
+	if (wr.bufferSize)
+	{
+		json.append(",\"buffers\":[{\"byteLength\":" + std::to_string(wr.bufferSize));
+
+		if (!binary)
+		{
+			json.append(",\"uri\":");
+			AppendJSONString(json, modelName + ".bin");
+		}
+
+		json.append("}]");
+	}
+
+	json.push_back('}');
+
+	outStats.jsonSize = json.size();
+	outStats.bufferSize = wr.bufferSize;
+	outStats.copiedSize = wr.copiedSize;
+
+	if (binary)
+		return WriteGLB(fileName, json, wr);
+
+	FILE *fle = _tfopen(fileName, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	bool written = fwrite(json.data(), 1, json.size(), fle) == json.size();
+	written = !fclose(fle) && written;
+
+	return written && (!wr.bufferSize || WriteBin((basePath + _T(".bin")).c_str(), wr));
+}
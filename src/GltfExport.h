@@ -0,0 +1,39 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "ModelStaging.h"
+
+// Sizes and counts of a single export.
+struct GltfExportStats
+{
+	size_t jsonSize;
+	size_t bufferSize;
+	size_t copiedSize; // part of buffer that had to be converted, rest is streamed straight from staging
+	int numMeshes;
+	int numJoints;
+	int numTargets;
+
+	GltfExportStats() : jsonSize(0), bufferSize(0), copiedSize(0), numMeshes(0), numJoints(0), numTargets(0) {}
+};
+
+// Writes every staged LOD into a glTF 2.0 file, .glb extension selects binary container,
+// anything else writes json with buffer in a .bin file of the same name.
+// Meshes stay in Max space, root node rotates them back to Y up.
+// Highest detail LOD is the only LOD in scene, lower ones are listed by its MSFT_lod extension.
+// Bones are joint nodes named same as bone helpers of importer, without bind poses.
+bool ExportGltf(const ModelStaging &staging, const TCHAR *fileName, GltfExportStats &outStats);
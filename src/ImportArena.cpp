@@ -0,0 +1,123 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ImportArena.h"
+#include "ImportMemory.h"
+#include <new>
+
+static const size_t arenaAlignment = alignof(std::max_align_t);
+static thread_local ImportArena *currentArena = nullptr;
+
+static size_t AlignArena(size_t bytes)
+{
+	return (bytes + arenaAlignment - 1) & ~(arenaAlignment - 1);
+}
+
+void *ImportArena::Allocate(size_t bytes)
+{
+	bytes = AlignArena(bytes);
+	std::lock_guard<std::mutex> guard(lock);
+
+	// Big buffers get their own block, so the shared one isn't wasted.
+	const bool dedicated = bytes > BLOCK_SIZE / 4;
+	const bool fits = !blocks.empty() && used + bytes <= blocks.back().size;
+
+	if (dedicated || !fits)
+	{
+		Block block;
+		block.size = dedicated ? bytes : BLOCK_SIZE;
+		block.data = static_cast<char *>(::operator new(block.size));
+		CountHeapAllocation();
+		reserved += block.size;
+		importMemory.Allocate(MemoryCategory_Arena, block.size);
+
+		if (dedicated && !blocks.empty())
+		{
+			// Keep the partially used block last, it still has room.
+			blocks.insert(blocks.end() - 1, block);
+			return block.data;
+		}
+
+		blocks.push_back(block);
+		used = 0;
+	}
+
+	char *result = blocks.back().data + used;
+	used += bytes;
+
+	return result;
+}
+
+void ImportArena::Release()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	for (auto &b : blocks)
+		::operator delete(b.data);
+
+	importMemory.Free(MemoryCategory_Arena, reserved);
+	blocks.clear();
+	used = 0;
+	reserved = 0;
+}
+
+ImportArena *ImportArena::Current()
+{
+	return currentArena;
+}
+
+ScopedArena::ScopedArena(ImportArena *arena) : previous(currentArena)
+{
+	currentArena = arena;
+}
+
+ScopedArena::~ScopedArena()
+{
+	currentArena = previous;
+}
+
+// Every transient allocation is prefixed with the arena it came from, null for heap.
+struct TransientHeader
+{
+	ImportArena *arena;
+};
+
+static const size_t transientHeaderSize = AlignArena(sizeof(TransientHeader));
+
+void *TransientAllocate(size_t bytes)
+{
+	ImportArena *arena = currentArena;
+
+	if (!arena)
+		CountHeapAllocation();
+
+	char *data = static_cast<char *>(arena ? arena->Allocate(bytes + transientHeaderSize) : ::operator new(bytes + transientHeaderSize));
+	reinterpret_cast<TransientHeader *>(data)->arena = arena;
+
+	return data + transientHeaderSize;
+}
+
+void TransientFree(void *data)
+{
+	if (!data)
+		return;
+
+	char *base = static_cast<char *>(data) - transientHeaderSize;
+
+	if (!reinterpret_cast<TransientHeader *>(base)->arena)
+		::operator delete(base);
+}
@@ -0,0 +1,71 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Bump allocator for transient import data, everything is released at once.
+// Blocks are never reused before Release, freeing a single allocation is a no-op.
+class ImportArena
+{
+	struct Block
+	{
+		char *data;
+		size_t size;
+	};
+
+	std::mutex lock;
+	std::vector<Block> blocks;
+	size_t used;
+	size_t reserved;
+
+	static const size_t BLOCK_SIZE = 1024 * 1024;
+
+public:
+	ImportArena() : used(0), reserved(0) {}
+	~ImportArena() { Release(); }
+	ImportArena(const ImportArena &) = delete;
+	ImportArena &operator=(const ImportArena &) = delete;
+
+	// Thread safe, result is aligned to max_align_t.
+	void *Allocate(size_t bytes);
+	void Release();
+
+	size_t Reserved() const { return reserved; }
+
+	// Arena bound to the calling thread, tasks inherit the arena of the thread that queued them.
+	static ImportArena *Current();
+};
+
+// Binds an arena to the calling thread for the scope lifetime.
+class ScopedArena
+{
+	ImportArena *previous;
+
+public:
+	explicit ScopedArena(ImportArena *arena);
+	~ScopedArena();
+	ScopedArena(const ScopedArena &) = delete;
+	ScopedArena &operator=(const ScopedArena &) = delete;
+};
+
+// Allocates from the bound arena, or from heap when none is bound.
+// Either kind can be passed into TransientFree from any thread.
+void *TransientAllocate(size_t bytes);
+void TransientFree(void *data);
@@ -0,0 +1,114 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ImportMemory.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+ImportMemory importMemory;
+
+static const char *categoryNames[MemoryCategory_Count] =
+{
+	"adfBuffers",
+	"mappedFiles",
+	"staging",
+	"arena",
+};
+
+static std::atomic<int64_t> heapAllocations(0);
+
+void CountHeapAllocation()
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t HeapAllocationCount()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+
+ImportMemory::ImportMemory() : budget(0)
+{
+	for (int c = 0; c < MemoryCategory_Count; c++)
+	{
+		current[c] = 0;
+		peak[c] = 0;
+	}
+}
+
+void ImportMemory::ResetPeaks()
+{
+	for (int c = 0; c < MemoryCategory_Count; c++)
+		peak[c] = current[c].load(std::memory_order_relaxed);
+}
+
+void ImportMemory::Allocate(MemoryCategory category, size_t bytes)
+{
+	const int64_t now = current[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64_t oldPeak = peak[category].load(std::memory_order_relaxed);
+
+	while (now > oldPeak && !peak[category].compare_exchange_weak(oldPeak, now, std::memory_order_relaxed)) {}
+}
+
+void ImportMemory::Free(MemoryCategory category, size_t bytes)
+{
+	current[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool ImportMemory::OverBudget() const
+{
+	const int64_t limit = budget;
+
+	return limit > 0 && ProcessRSS() > limit;
+}
+
+const char *ImportMemory::CategoryName(MemoryCategory category)
+{
+	return categoryNames[category];
+}
+
+int64_t ImportMemory::ProcessRSS()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return static_cast<int64_t>(counters.WorkingSetSize);
+#elif defined(__linux__)
+	FILE *fle = fopen("/proc/self/statm", "r");
+
+	if (!fle)
+		return 0;
+
+	long long numPages = 0, numResident = 0;
+	const bool read = fscanf(fle, "%lld %lld", &numPages, &numResident) == 2;
+	fclose(fle);
+
+	return read ? numResident * sysconf(_SC_PAGESIZE) : 0;
+#else
+	return 0;
+#endif
+}
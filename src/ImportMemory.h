@@ -0,0 +1,117 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+#include "ImportArena.h"
+
+enum MemoryCategory
+{
+	MemoryCategory_ADF,
+	MemoryCategory_Mapped,
+	MemoryCategory_Staging,
+	MemoryCategory_Arena,
+	MemoryCategory_Count
+};
+
+// Live and peak bytes of plugin owned buffers.
+// Max scene objects and bitmaps are not ours to track, they show up in process RSS deltas of their phases.
+// Arena counts reserved blocks, categories placed in arena count requested bytes.
+class ImportMemory
+{
+	std::atomic<int64_t> current[MemoryCategory_Count];
+	std::atomic<int64_t> peak[MemoryCategory_Count];
+	std::atomic<int64_t> budget;
+
+public:
+	ImportMemory();
+
+	// Live allocations are kept, peaks start over from them.
+	void ResetPeaks();
+
+	void Allocate(MemoryCategory category, size_t bytes);
+	void Free(MemoryCategory category, size_t bytes);
+
+	int64_t Current(MemoryCategory category) const { return current[category].load(std::memory_order_relaxed); }
+	int64_t Peak(MemoryCategory category) const { return peak[category].load(std::memory_order_relaxed); }
+
+	// Process RSS limit in bytes, 0 disables it.
+	void SetBudget(int64_t bytes) { budget = bytes; }
+	int64_t Budget() const { return budget; }
+	bool OverBudget() const;
+
+	static const char *CategoryName(MemoryCategory category);
+
+	// Resident set size of the whole process, 0 when unsupported.
+	static int64_t ProcessRSS();
+};
+
+extern ImportMemory importMemory;
+
+// Heap allocations made by tracked allocators since start, transient ones without a bound arena and arena blocks.
+// Plain std containers and Max objects go around it.
+void CountHeapAllocation();
+int64_t HeapAllocationCount();
+
+// Lives in the arena bound to the allocating thread, see ImportArena.
+template<class T, MemoryCategory category>
+class TrackingAllocator
+{
+public:
+	typedef T value_type;
+
+	template<class U>
+	struct rebind { typedef TrackingAllocator<U, category> other; };
+
+	TrackingAllocator() noexcept {}
+
+	template<class U>
+	TrackingAllocator(const TrackingAllocator<U, category> &) noexcept {}
+
+	T *allocate(size_t count)
+	{
+		T *data = static_cast<T *>(TransientAllocate(count * sizeof(T)));
+		importMemory.Allocate(category, count * sizeof(T));
+
+		return data;
+	}
+
+	void deallocate(T *data, size_t count) noexcept
+	{
+		importMemory.Free(category, count * sizeof(T));
+		TransientFree(data);
+	}
+
+	template<class U>
+	bool operator==(const TrackingAllocator<U, category> &) const noexcept { return true; }
+
+	template<class U>
+	bool operator!=(const TrackingAllocator<U, category> &) const noexcept { return false; }
+};
+
+template<class T, MemoryCategory category>
+using TrackedVector = std::vector<T, TrackingAllocator<T, category>>;
+
+template<class T>
+using StagingVector = TrackedVector<T, MemoryCategory_Staging>;
+
+typedef std::basic_string<char, std::char_traits<char>, TrackingAllocator<char, MemoryCategory_Staging>> StagingString;
@@ -0,0 +1,150 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ImportProfiler.h"
+#include "datas/masterprinter.hpp"
+
+ImportProfiler importProfiler;
+
+static double ToMB(int64_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+static const char *phaseNames[ImportPhase_Count] =
+{
+	"total",
+	"fileLoad",
+	"decode",
+	"optimize",
+	"commit",
+	"commitFlush",
+	"materials",
+	"mesh",
+	"deform",
+	"stuntArea",
+};
+
+static const char *counterNames[ImportCounter_Count] =
+{
+	"files",
+	"meshes",
+	"vertices",
+	"faces",
+	"materials",
+	"textures",
+	"bones",
+	"instances",
+	"heapAllocs",
+	"nodesUpdated",
+	"nodesKept",
+	"proxies",
+	"culled",
+};
+
+void ImportProfiler::Reset()
+{
+	for (int p = 0; p < ImportPhase_Count; p++)
+	{
+		phaseTime[p] = 0;
+		phaseCalls[p] = 0;
+		phaseRSSGrowth[p] = 0;
+		phasePeakRSS[p] = 0;
+	}
+
+	for (int c = 0; c < ImportCounter_Count; c++)
+		counters[c] = 0;
+
+	importMemory.ResetPeaks();
+	heapAllocationsBase = HeapAllocationCount();
+}
+
+void ImportProfiler::Finish()
+{
+	counters[ImportCounter_HeapAllocations] = HeapAllocationCount() - heapAllocationsBase;
+}
+
+void ImportProfiler::AddTime(ImportPhase phase, Clock::duration elapsed)
+{
+	phaseTime[phase].fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), std::memory_order_relaxed);
+	phaseCalls[phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ImportProfiler::AddRSS(ImportPhase phase, int64_t rssBegin, int64_t rssEnd)
+{
+	phaseRSSGrowth[phase].fetch_add(rssEnd - rssBegin, std::memory_order_relaxed);
+
+	const int64_t rssPeak = rssEnd > rssBegin ? rssEnd : rssBegin;
+	int64_t oldPeak = phasePeakRSS[phase].load(std::memory_order_relaxed);
+
+	while (rssPeak > oldPeak && !phasePeakRSS[phase].compare_exchange_weak(oldPeak, rssPeak, std::memory_order_relaxed)) {}
+}
+
+double ImportProfiler::Seconds(ImportPhase phase) const
+{
+	return phaseTime[phase].load(std::memory_order_relaxed) * 1e-6;
+}
+
+const char *ImportProfiler::PhaseName(ImportPhase phase)
+{
+	return phaseNames[phase];
+}
+
+const char *ImportProfiler::CounterName(ImportCounter counter)
+{
+	return counterNames[counter];
+}
+
+void ImportProfiler::Report() const
+{
+	printer << "[Apex] Import profile:" >> 1;
+
+	for (int p = 0; p < ImportPhase_Count; p++)
+	{
+		const ImportPhase phase = static_cast<ImportPhase>(p);
+
+		if (!Calls(phase))
+			continue;
+
+		printer << "\t" << PhaseName(phase) << ": " << Seconds(phase) << "s (" << Calls(phase) << " call(s))";
+
+		if (SamplesRSS(phase))
+			printer << ", rss " << (RSSGrowth(phase) >= 0 ? "+" : "") << ToMB(RSSGrowth(phase)) << " MB, peak "
+				<< ToMB(PeakRSS(phase)) << " MB";
+
+		printer >> 1;
+	}
+
+	printer << "\t";
+
+	for (int c = 0; c < ImportCounter_Count; c++)
+	{
+		const ImportCounter counter = static_cast<ImportCounter>(c);
+		printer << (c ? ", " : "") << CounterName(counter) << ": " << Count(counter);
+	}
+
+	printer >> 1;
+	printer << "\t";
+
+	for (int c = 0; c < MemoryCategory_Count; c++)
+	{
+		const MemoryCategory category = static_cast<MemoryCategory>(c);
+		printer << (c ? ", " : "") << ImportMemory::CategoryName(category) << ": " << ToMB(importMemory.Peak(category)) << " MB peak";
+	}
+
+	printer >> 1;
+}
@@ -0,0 +1,133 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "ImportMemory.h"
+#include "ImportTrace.h"
+
+enum ImportPhase
+{
+	ImportPhase_Total,
+	ImportPhase_FileLoad,
+	ImportPhase_Decode,
+	ImportPhase_Optimize,
+	ImportPhase_Commit,
+	ImportPhase_CommitFlush,
+	ImportPhase_Materials,
+	ImportPhase_Mesh,
+	ImportPhase_Deform,
+	ImportPhase_StuntArea,
+	ImportPhase_Count
+};
+
+enum ImportCounter
+{
+	ImportCounter_Files,
+	ImportCounter_Meshes,
+	ImportCounter_Vertices,
+	ImportCounter_Faces,
+	ImportCounter_Materials,
+	ImportCounter_Textures,
+	ImportCounter_Bones,
+	ImportCounter_Instances,
+	ImportCounter_HeapAllocations,
+	ImportCounter_NodesUpdated,
+	ImportCounter_NodesKept,
+	ImportCounter_Proxies,
+	ImportCounter_Culled,
+	ImportCounter_Count
+};
+
+// Accumulated phase times and counters of the last import run.
+// Safe to update from worker threads, phases running on workers sum up their thread time.
+// Process RSS is sampled at boundaries of top level phases only, concurrent phases share their growth.
+class ImportProfiler
+{
+	std::atomic<int64_t> phaseTime[ImportPhase_Count];
+	std::atomic<int> phaseCalls[ImportPhase_Count];
+	std::atomic<int64_t> phaseRSSGrowth[ImportPhase_Count];
+	std::atomic<int64_t> phasePeakRSS[ImportPhase_Count];
+	std::atomic<int64_t> counters[ImportCounter_Count];
+	int64_t heapAllocationsBase;
+
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	ImportProfiler() { Reset(); }
+
+	void Reset();
+
+	// Closes counters sampled over the whole run, call once the import is done.
+	void Finish();
+	void AddTime(ImportPhase phase, Clock::duration elapsed);
+	void AddRSS(ImportPhase phase, int64_t rssBegin, int64_t rssEnd);
+	void Add(ImportCounter counter, int64_t value = 1) { counters[counter].fetch_add(value, std::memory_order_relaxed); }
+
+	double Seconds(ImportPhase phase) const;
+	int Calls(ImportPhase phase) const { return phaseCalls[phase].load(std::memory_order_relaxed); }
+	int64_t RSSGrowth(ImportPhase phase) const { return phaseRSSGrowth[phase].load(std::memory_order_relaxed); }
+	int64_t PeakRSS(ImportPhase phase) const { return phasePeakRSS[phase].load(std::memory_order_relaxed); }
+	int64_t Count(ImportCounter counter) const { return counters[counter].load(std::memory_order_relaxed); }
+
+	// Writes a per phase summary and plugin memory usage through printer.
+	void Report() const;
+
+	static const char *PhaseName(ImportPhase phase);
+
+	// Top level phases run once per import or per file, nested per mesh phases record time and counters only.
+	static bool SamplesRSS(ImportPhase phase)
+	{
+		return phase == ImportPhase_Total || phase == ImportPhase_FileLoad || phase == ImportPhase_Commit ||
+			phase == ImportPhase_CommitFlush;
+	}
+
+	static const char *CounterName(ImportCounter counter);
+};
+
+extern ImportProfiler importProfiler;
+
+// Times a phase, samples process RSS for top level phases and emits a trace span tagged with detail when tracing.
+class ScopedPhase
+{
+	ImportPhase phase;
+	const char *detail;
+	int64_t startRSS;
+	ImportProfiler::Clock::time_point start;
+
+public:
+	explicit ScopedPhase(ImportPhase phase, const char *detail = nullptr) :
+		phase(phase), detail(detail), startRSS(ImportProfiler::SamplesRSS(phase) ? ImportMemory::ProcessRSS() : 0),
+		start(ImportProfiler::Clock::now()) {}
+
+	~ScopedPhase()
+	{
+		const ImportProfiler::Clock::time_point end = ImportProfiler::Clock::now();
+		importProfiler.AddTime(phase, end - start);
+
+		if (ImportProfiler::SamplesRSS(phase))
+			importProfiler.AddRSS(phase, startRSS, ImportMemory::ProcessRSS());
+
+		if (importTrace.Enabled())
+			importTrace.AddSpan(ImportProfiler::PhaseName(phase), detail, start, end);
+	}
+
+	ScopedPhase(const ScopedPhase &) = delete;
+	ScopedPhase &operator=(const ScopedPhase &) = delete;
+};
@@ -0,0 +1,134 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ImportTrace.h"
+#include <cstdio>
+
+ImportTrace importTrace;
+
+static thread_local int traceThread = -1;
+
+static void AppendEscaped(std::string &buffer, const char *str)
+{
+	buffer.push_back('"');
+
+	for (; *str; str++)
+	{
+		const char c = *str;
+
+		if (c == '"' || c == '\\')
+		{
+			buffer.push_back('\\');
+			buffer.push_back(c);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char hex[8];
+			snprintf(hex, sizeof(hex), "\\u%04x", c);
+			buffer.append(hex);
+		}
+		else
+			buffer.push_back(c);
+	}
+
+	buffer.push_back('"');
+}
+
+void ImportTrace::Begin()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	spans.clear();
+	origin = Clock::now();
+
+	// Begin runs on the main thread, keep it on the first row.
+	if (traceThread < 0)
+		traceThread = numThreads++;
+
+	enabled = true;
+}
+
+void ImportTrace::AddSpan(const char *name, const char *detail, Clock::time_point start, Clock::time_point end)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (!enabled)
+		return;
+
+	if (traceThread < 0)
+		traceThread = numThreads++;
+
+	Span span;
+	span.name = name;
+	span.detail = detail ? detail : "";
+	span.start = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+	span.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	span.thread = traceThread;
+	spans.push_back(std::move(span));
+}
+
+bool ImportTrace::End(const TCHAR *path)
+{
+	std::vector<Span> collected;
+	int collectedThreads;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		enabled = false;
+		collected.swap(spans);
+		collectedThreads = numThreads;
+	}
+
+	std::string buffer = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	char entry[128];
+
+	for (int t = 0; t < collectedThreads; t++)
+	{
+		snprintf(entry, sizeof(entry), "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+			t ? "," : "", t, t ? "Worker" : "Main", t);
+		buffer.append(entry);
+	}
+
+	for (auto &s : collected)
+	{
+		buffer.append(",\n{\"name\": ");
+		AppendEscaped(buffer, s.name);
+		snprintf(entry, sizeof(entry), ", \"cat\": \"import\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %lld, \"dur\": %lld",
+			s.thread, static_cast<long long>(s.start), static_cast<long long>(s.duration));
+		buffer.append(entry);
+
+		if (!s.detail.empty())
+		{
+			buffer.append(", \"args\": {\"detail\": ");
+			AppendEscaped(buffer, s.detail.c_str());
+			buffer.push_back('}');
+		}
+
+		buffer.push_back('}');
+	}
+
+	buffer.append("\n]}\n");
+
+	FILE *fle = _tfopen(path, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	const bool written = fwrite(buffer.data(), 1, buffer.size(), fle) == buffer.size();
+	fclose(fle);
+
+	return written;
+}
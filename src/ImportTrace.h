@@ -0,0 +1,90 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ApexCompat.h"
+
+// Records complete spans in trace event format (chrome://tracing, Perfetto).
+// Recording is off unless Begin was called, disabled spans cost one atomic load.
+class ImportTrace
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	struct Span
+	{
+		const char *name;
+		std::string detail;
+		int64_t start;
+		int64_t duration;
+		int thread;
+	};
+
+	std::atomic<bool> enabled;
+	std::mutex lock;
+	std::vector<Span> spans;
+	Clock::time_point origin;
+	int numThreads;
+
+public:
+	ImportTrace() : enabled(false), numThreads(0) {}
+
+	void Begin();
+	// Stops recording, writes out collected spans and frees them.
+	bool End(const TCHAR *path);
+
+	bool Enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	// name must be a string literal or otherwise outlive the trace.
+	void AddSpan(const char *name, const char *detail, Clock::time_point start, Clock::time_point end);
+};
+
+extern ImportTrace importTrace;
+
+class ScopedTrace
+{
+	const char *name;
+	std::string detail;
+	ImportTrace::Clock::time_point start;
+	bool active;
+
+public:
+	ScopedTrace(const char *name, std::string detail = std::string()) :
+		name(name), active(importTrace.Enabled())
+	{
+		if (!active)
+			return;
+
+		this->detail = std::move(detail);
+		start = ImportTrace::Clock::now();
+	}
+
+	~ScopedTrace()
+	{
+		if (active)
+			importTrace.AddSpan(name, detail.c_str(), start, ImportTrace::Clock::now());
+	}
+
+	ScopedTrace(const ScopedTrace &) = delete;
+	ScopedTrace &operator=(const ScopedTrace &) = delete;
+};
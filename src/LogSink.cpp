@@ -0,0 +1,181 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LogSink.h"
+#include <vector>
+#include <unordered_map>
+
+typedef std::basic_string<TCHAR> LogString;
+
+LogSink logSink;
+
+LogSink::LogSink() : tail(&stub), output(nullptr), logFile(nullptr), minSeverity(LogSeverity_Info)
+{
+	stub.next.store(nullptr, std::memory_order_relaxed);
+	head.store(&stub, std::memory_order_relaxed);
+}
+
+LogSink::~LogSink()
+{
+	while (Message *msg = Pop())
+		delete msg;
+
+	CloseFile();
+}
+
+LogSeverity LogSink::Classify(const TCHAR *msg)
+{
+	static const int searchLength = 32;
+
+	for (int c = 0; c < searchLength && msg[c]; c++)
+	{
+		if (!_tcsncmp(msg + c, _T("ERROR"), 5))
+			return LogSeverity_Error;
+		else if (!_tcsncmp(msg + c, _T("WARNING"), 7))
+			return LogSeverity_Warning;
+	}
+
+	return LogSeverity_Info;
+}
+
+void LogSink::Push(const TCHAR *msg)
+{
+	Message *item = new Message;
+	item->text = msg;
+	item->next.store(nullptr, std::memory_order_relaxed);
+
+	Message *prev = head.exchange(item, std::memory_order_acq_rel);
+	prev->next.store(item, std::memory_order_release);
+}
+
+// Single consumer side of the queue, only Drain may call this.
+LogSink::Message *LogSink::Pop()
+{
+	Message *cTail = tail;
+	Message *next = cTail->next.load(std::memory_order_acquire);
+
+	if (cTail == &stub)
+	{
+		if (!next)
+			return nullptr;
+
+		tail = next;
+		cTail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if (next)
+	{
+		tail = next;
+		return cTail;
+	}
+
+	// A producer is between exchange and link, pick the message up next time.
+	if (cTail != head.load(std::memory_order_acquire))
+		return nullptr;
+
+	stub.next.store(nullptr, std::memory_order_relaxed);
+	Message *prev = head.exchange(&stub, std::memory_order_acq_rel);
+	prev->next.store(&stub, std::memory_order_release);
+
+	next = cTail->next.load(std::memory_order_acquire);
+
+	if (next)
+	{
+		tail = next;
+		return cTail;
+	}
+
+	return nullptr;
+}
+
+bool LogSink::OpenFile(const TCHAR *path)
+{
+	CloseFile();
+	logFile = _tfopen(path, _T("at"));
+
+	return logFile != nullptr;
+}
+
+void LogSink::CloseFile()
+{
+	if (!logFile)
+		return;
+
+	fclose(logFile);
+	logFile = nullptr;
+}
+
+void LogSink::Drain()
+{
+	std::vector<std::pair<LogString, int>> entries;
+	std::unordered_map<LogString, size_t> entryLookup;
+
+	while (Message *msg = Pop())
+	{
+		if (Classify(msg->text.c_str()) >= minSeverity)
+		{
+			auto found = entryLookup.find(msg->text);
+
+			if (found == entryLookup.end())
+			{
+				entryLookup[msg->text] = entries.size();
+				entries.emplace_back(std::move(msg->text), 1);
+			}
+			else
+				entries[found->second].second++;
+		}
+
+		delete msg;
+	}
+
+	if (entries.empty())
+		return;
+
+	LogString outBuffer;
+
+	for (auto &e : entries)
+	{
+		LogString &text = e.first;
+
+		if (e.second > 1)
+		{
+			const bool hasNewLine = text.back() == '\n';
+
+			if (hasNewLine)
+				text.pop_back();
+
+			TCHAR repeated[48];
+			_stprintf_s(repeated, _T(" (repeated %i times)"), e.second);
+			text.append(repeated);
+
+			if (hasNewLine)
+				text.push_back('\n');
+		}
+
+		outBuffer.append(text);
+	}
+
+	if (output)
+		output(outBuffer.c_str());
+
+	if (logFile)
+	{
+		_fputts(outBuffer.c_str(), logFile);
+		fflush(logFile);
+	}
+}
@@ -0,0 +1,69 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <tchar.h>
+
+enum LogSeverity
+{
+	LogSeverity_Info,
+	LogSeverity_Warning,
+	LogSeverity_Error,
+};
+
+// Collects printer messages from any thread without locking.
+// Messages are filtered, merged and written out only when Drain is called.
+class LogSink
+{
+public:
+	typedef void(*OutputFunc)(const TCHAR *messages);
+
+private:
+	struct Message
+	{
+		std::atomic<Message *> next;
+		std::basic_string<TCHAR> text;
+	};
+
+	std::atomic<Message *> head;
+	Message *tail;
+	Message stub;
+	OutputFunc output;
+	FILE *logFile;
+	LogSeverity minSeverity;
+
+	Message *Pop();
+
+public:
+	LogSink();
+	~LogSink();
+
+	void Push(const TCHAR *msg);
+	void Drain();
+
+	void SetOutput(OutputFunc func) { output = func; }
+	void SetMinSeverity(LogSeverity severity) { minSeverity = severity; }
+	bool OpenFile(const TCHAR *path);
+	void CloseFile();
+
+	static LogSeverity Classify(const TCHAR *msg);
+};
+
+extern LogSink logSink;
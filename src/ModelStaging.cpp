@@ -0,0 +1,687 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ModelStaging.h"
+#include "ImportProfiler.h"
+#include "TaskScheduler.h"
+#include "StuntAreas.h"
+#include "StagingKernels.h"
+#include "datas/masterprinter.hpp"
+#include <cfloat>
+#include <climits>
+
+void LODFilter::Parse(const TCHAR *filter)
+{
+	indices.clear();
+	highestDetail = false;
+	lowestDetail = false;
+
+	std::basic_string<TCHAR> token;
+
+	for (const TCHAR *c = filter; ; c++)
+	{
+		if (*c && *c != ',' && *c != ';' && *c != ' ')
+		{
+			token.push_back(*c);
+			continue;
+		}
+
+		if (!token.empty())
+		{
+			if (!_tcsicmp(token.c_str(), _T("first")))
+				highestDetail = true;
+			else if (!_tcsicmp(token.c_str(), _T("last")))
+				lowestDetail = true;
+			else
+				indices.push_back(_ttoi(token.c_str()));
+
+			token.clear();
+		}
+
+		if (!*c)
+			break;
+	}
+}
+
+bool StagingRegion::Parse(const TCHAR *text)
+{
+	shape = Shape_None;
+
+	while (*text == ' ')
+		text++;
+
+	if (!*text)
+		return true;
+
+	Shape parsed;
+	int numValues;
+
+	if (!_tcsnicmp(text, _T("box"), 3))
+	{
+		parsed = Shape_Box;
+		numValues = 6;
+		text += 3;
+	}
+	else if (!_tcsnicmp(text, _T("sphere"), 6))
+	{
+		parsed = Shape_Sphere;
+		numValues = 4;
+		text += 6;
+	}
+	else
+		return false;
+
+	for (int v = 0; v < numValues; v++)
+	{
+		TCHAR *end;
+		values[v] = static_cast<float>(_tcstod(text, &end));
+
+		if (end == text)
+			return false;
+
+		text = end;
+	}
+
+	if (parsed == Shape_Box)
+		for (int a = 0; a < 3; a++)
+			if (values[a] > values[a + 3])
+			{
+				const float temp = values[a];
+				values[a] = values[a + 3];
+				values[a + 3] = temp;
+			}
+
+	shape = parsed;
+
+	return true;
+}
+
+bool StagingRegion::Accepts(const Vector &boundsMin, const Vector &boundsMax) const
+{
+	const float *bmin = &boundsMin.X;
+	const float *bmax = &boundsMax.X;
+
+	switch (shape)
+	{
+	case Shape_Box:
+		for (int a = 0; a < 3; a++)
+			if (bmax[a] < values[a] || bmin[a] > values[a + 3])
+				return false;
+
+		return true;
+	case Shape_Sphere:
+	{
+		float distance = 0.0f;
+
+		for (int a = 0; a < 3; a++)
+		{
+			const float center = values[a];
+			const float closest = center < bmin[a] ? bmin[a] : (center > bmax[a] ? bmax[a] : center);
+			distance += (center - closest) * (center - closest);
+		}
+
+		return distance <= values[3] * values[3];
+	}
+	default:
+		return true;
+	}
+}
+
+bool LODFilter::Accepts(int lodIndex, int highestDetailIndex, int lowestDetailIndex) const
+{
+	if (Empty())
+		return true;
+
+	if (highestDetail && lodIndex == highestDetailIndex)
+		return true;
+
+	if (lowestDetail && lodIndex == lowestDetailIndex)
+		return true;
+
+	for (int i : indices)
+		if (i == lodIndex)
+			return true;
+
+	return false;
+}
+
+static_assert(sizeof(Vector) == sizeof(float) * 3 && sizeof(Vector2) == sizeof(float) * 2 && sizeof(Vector4) == sizeof(float) * 4,
+	"Staging kernels expect tightly packed vectors");
+
+static float *Floats(StagingVector<Vector> &vec) { return reinterpret_cast<float *>(vec.data()); }
+
+// ApexLib hands out both C strings and std::string, either gets copied into the bound arena.
+static StagingString ToStaging(const char *text) { return text ? StagingString(text) : StagingString(); }
+static StagingString ToStaging(const std::string &text) { return StagingString(text.data(), text.size()); }
+
+static void DecodeSkin(MeshStaging &staging)
+{
+	std::vector<AmfVertexDescriptor *> weights;
+	std::vector<AmfVertexDescriptor *> bonesids;
+
+	for (auto &d : staging.descriptors)
+	{
+		switch (d->usage)
+		{
+		case AmfUsage_BoneIndex:
+			bonesids.push_back(d.get());
+			break;
+		case AmfUsage_BoneWeight:
+			weights.push_back(d.get());
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!bonesids.size())
+		return;
+
+	SkinStaging &skin = staging.skin;
+	const int numVerts = staging.numVertices;
+
+	if (!weights.size())
+	{
+		skin.numInfluences = 1;
+		skin.indices.resize(numVerts);
+		skin.weights.assign(numVerts, 1.0f);
+
+		for (int v = 0; v < numVerts; v++)
+			bonesids[0]->Evaluate(v, &skin.indices[v]);
+
+		return;
+	}
+
+	static const int maxSets = 2;
+	const int numBoneSets = static_cast<int>(bonesids.size());
+	const int numSets = weights.size() == 1 ? 1 : (numBoneSets < maxSets ? numBoneSets : maxSets);
+	std::vector<UCVector4> indexSets[maxSets];
+	std::vector<Vector4> weightSets[maxSets];
+	const uint8_t *indexPtrs[maxSets];
+	const float *weightPtrs[maxSets];
+
+	for (int d = 0; d < numSets; d++)
+	{
+		indexSets[d].resize(numVerts);
+		weightSets[d].resize(numVerts);
+
+		for (int v = 0; v < numVerts; v++)
+		{
+			bonesids[d]->Evaluate(v, &indexSets[d][v]);
+			weights[d]->Evaluate(v, &weightSets[d][v]);
+		}
+
+		indexPtrs[d] = reinterpret_cast<const uint8_t *>(indexSets[d].data());
+		weightPtrs[d] = reinterpret_cast<const float *>(weightSets[d].data());
+	}
+
+	skin.numInfluences = numSets * 4;
+	skin.indices.resize(numVerts * skin.numInfluences);
+	skin.weights.resize(numVerts * skin.numInfluences);
+	FlattenInfluences(indexPtrs, weightPtrs, numSets, numVerts, skin.indices.data(), skin.weights.data());
+}
+
+static void DecodeMorph(MeshStaging &staging, AmfVertexDescriptor *deform, AmfVertexDescriptor *points)
+{
+	MorphStaging &morph = staging.morph;
+	const int numVerts = staging.numVertices;
+
+	morph.deltas.resize(numVerts);
+
+	for (int v = 0; v < numVerts; v++)
+		deform->Evaluate(v, &morph.deltas[v]);
+
+	ApexToMaxSpace(Floats(morph.deltas), numVerts, 2.0f);
+
+	if (!points)
+		return;
+
+	std::vector<Vector4> cpoints(numVerts);
+
+	for (int v = 0; v < numVerts; v++)
+		points->Evaluate(v, &cpoints[v]);
+
+	morph.controlChannels.resize(numVerts);
+	morph.controlWeights.resize(numVerts);
+	DecodeControlPoints(reinterpret_cast<const float *>(cpoints.data()), reinterpret_cast<uint32_t *>(morph.controlChannels.data()),
+		reinterpret_cast<float *>(morph.controlWeights.data()), numVerts);
+}
+
+bool StageBounds(MeshStaging &staging, const StagingSettings &settings)
+{
+	ComputeBounds(Floats(staging.positions), staging.positions.size(), &staging.boundsMin.X, &staging.boundsMax.X);
+
+	if (!settings.region.Accepts(staging.boundsMin, staging.boundsMax))
+	{
+		staging.culled = true;
+		staging.numVertices = 0;
+		staging.numFaces = 0;
+		StagingVector<Vector>().swap(staging.positions);
+		importProfiler.Add(ImportCounter_Culled);
+
+		return false;
+	}
+
+	if (!settings.boundsOnly)
+		return true;
+
+	StagingVector<Vector>().swap(staging.positions);
+	importProfiler.Add(ImportCounter_Meshes);
+	importProfiler.Add(ImportCounter_Vertices, staging.numVertices);
+
+	return false;
+}
+
+void DecodeMesh(MeshStaging &staging, const StagingSettings &settings)
+{
+	AmfMesh *imsh = staging.source.get();
+	staging.name = ToStaging(imsh->GetSubMeshName(0));
+
+	if (!imsh->IsValid())
+		return;
+
+	ScopedPhase phase(ImportPhase_Decode, staging.name.c_str());
+	staging.spriteRemap = imsh->GetRemapType() == REMAP_TYPE_SPRITE;
+
+	staging.numVertices = imsh->GetNumVertices();
+	staging.numFaces = imsh->GetNumIndices() / 3;
+	staging.descriptors = imsh->GetDescriptors();
+
+	const int numVerts = staging.numVertices;
+	const int numSubMeshes = imsh->GetNumSubMeshes();
+	const int numRemaps = imsh->GetNumRemaps();
+
+	staging.remaps.resize(numRemaps);
+
+	for (int c = 0; c < numRemaps; c++)
+		staging.remaps[c] = imsh->GetRemap(c);
+
+	staging.subMeshNameHashes.resize(numSubMeshes);
+
+	for (int s = 0; s < numSubMeshes; s++)
+		staging.subMeshNameHashes[s] = imsh->GetSubMeshNameHash(s);
+
+	if (settings.headersOnly)
+	{
+		importProfiler.Add(ImportCounter_Meshes);
+		importProfiler.Add(ImportCounter_Vertices, staging.numVertices);
+		return;
+	}
+
+	// Positions go first, other streams aren't touched for culled meshes.
+	for (auto &d : staging.descriptors)
+		if (d->usage == AmfUsage_Position)
+		{
+			const float packer = *reinterpret_cast<float*>(d->packingData);
+			const float localScale = packer > FLT_EPSILON ? packer * settings.scale : settings.scale;
+			staging.positions.resize(numVerts);
+
+			for (int v = 0; v < numVerts; v++)
+				d->Evaluate(v, &staging.positions[v]);
+
+			ApexToMaxSpace(Floats(staging.positions), numVerts, localScale);
+			break;
+		}
+
+	if (!StageBounds(staging, settings))
+		return;
+
+	for (auto &d : staging.descriptors)
+	{
+		switch (d->usage)
+		{
+		case AmfUsage_Normal:
+		case AmfUsage_TangentSpace:
+		{
+			staging.normals.resize(numVerts);
+
+			for (int v = 0; v < numVerts; v++)
+				d->Evaluate(v, &staging.normals[v]);
+
+			ApexToMaxSpace(Floats(staging.normals), numVerts, 1.0f);
+			break;
+		}
+		case AmfUsage_TextureCoordinate:
+		{
+			Vector2 packer = *reinterpret_cast<Vector2*>(d->packingData);
+
+			if (!packer.Length())
+				packer = Vector2(1.0f, 1.0f);
+
+			std::vector<Vector2> uvs(numVerts);
+
+			for (int v = 0; v < numVerts; v++)
+				d->Evaluate(v, &uvs[v]);
+
+			staging.uvChannels.emplace_back(numVerts);
+			ExpandUVs(reinterpret_cast<const float *>(uvs.data()), Floats(staging.uvChannels.back()), numVerts, packer.X, packer.Y);
+			break;
+		}
+		case AmfUsage_Color:
+		{
+			staging.colors.resize(numVerts);
+
+			if (d->format == AmfFormat_R32_UNIT_UNSIGNED_VEC_AS_FLOAT_c)
+			{
+				for (int v = 0; v < numVerts; v++)
+					d->Evaluate(v, &staging.colors[v]);
+			}
+			else
+			{
+				std::vector<Vector4> rgba(numVerts);
+
+				for (int v = 0; v < numVerts; v++)
+					d->Evaluate(v, &rgba[v]);
+
+				staging.alpha.resize(numVerts);
+				SplitAlpha(reinterpret_cast<const float *>(rgba.data()), Floats(staging.colors), staging.alpha.data(), numVerts);
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	staging.faces.reserve(staging.numFaces);
+	staging.subMeshNumFaces.reserve(numSubMeshes);
+
+	for (int s = 0; s < numSubMeshes; s++)
+	{
+		const USVector *ibuff = reinterpret_cast<const USVector *>(imsh->GetIndicesBuffer(s));
+		const int curNumFaces = imsh->GetNumIndices(s) / 3;
+
+		staging.faces.insert(staging.faces.end(), ibuff, ibuff + curNumFaces);
+		staging.subMeshNumFaces.push_back(curNumFaces);
+	}
+
+	staging.numFaces = static_cast<int>(staging.faces.size());
+
+	// Optimizer, commit, thumbnails and exporters index vertex tables with these unchecked.
+	const uint16_t *indices = reinterpret_cast<const uint16_t *>(staging.faces.data());
+	const size_t numIndices = staging.faces.size() * 3;
+
+	for (size_t i = 0; i < numIndices; i++)
+		if (indices[i] >= numVerts)
+		{
+			printerror("[Apex] Face index out of vertex range, skipping mesh: ", << staging.name.c_str());
+			staging.numVertices = 0;
+			staging.numFaces = 0;
+			staging.faces.clear();
+			staging.subMeshNumFaces.clear();
+			return;
+		}
+
+	if (!staging.spriteRemap)
+	{
+		AmfVertexDescriptor *deform = nullptr,
+			*points = nullptr;
+
+		for (auto &d : staging.descriptors)
+			if (d->usage == AmfUsage_DeformNormal_c)
+				deform = d.get();
+			else if (d->usage == AmfUsage_DeformPoints_c)
+				points = d.get();
+
+		if (deform)
+			DecodeMorph(staging, deform, points);
+		else if (numRemaps > 1)
+			DecodeSkin(staging);
+	}
+
+	if (settings.optimizeMeshes)
+		OptimizeMesh(staging);
+
+	FingerprintMesh(staging);
+
+	importProfiler.Add(ImportCounter_Meshes);
+	importProfiler.Add(ImportCounter_Vertices, staging.numVertices);
+	importProfiler.Add(ImportCounter_Faces, staging.numFaces);
+}
+
+template<class Type>
+static void RemapVector(StagingVector<Type> &vec, size_t elementSize, size_t numVertices, const uint32_t *remap)
+{
+	if (vec.size() * sizeof(Type) == elementSize * numVertices)
+		RemapVertexStream(vec.data(), elementSize, numVertices, remap);
+}
+
+void OptimizeMesh(MeshStaging &staging)
+{
+	ScopedPhase phase(ImportPhase_Optimize, staging.name.c_str());
+	const size_t numVerts = staging.numVertices;
+	const int numSubMeshes = static_cast<int>(staging.subMeshNumFaces.size());
+	uint16_t *indices = reinterpret_cast<uint16_t *>(staging.faces.data());
+	const size_t numIndices = staging.faces.size() * 3;
+	std::vector<size_t> subMeshOffsets(numSubMeshes + 1, 0);
+
+	// Kernels index vertex sized tables, broken index buffers are left alone.
+	for (size_t i = 0; i < numIndices; i++)
+		if (indices[i] >= numVerts)
+			return;
+
+	for (int s = 0; s < numSubMeshes; s++)
+	{
+		const size_t offset = subMeshOffsets[s] + staging.subMeshNumFaces[s] * 3;
+		subMeshOffsets[s + 1] = offset < numIndices ? offset : numIndices;
+	}
+
+	auto optimizeTask = [&](size_t s)
+	{
+		uint16_t *subMeshIndices = indices + subMeshOffsets[s];
+		const size_t numSubMeshIndices = subMeshOffsets[s + 1] - subMeshOffsets[s];
+
+		OptimizeVertexCache(subMeshIndices, numSubMeshIndices, numVerts);
+		OptimizeOverdraw(subMeshIndices, numSubMeshIndices, Floats(staging.positions), numVerts);
+	};
+
+	if (taskScheduler && numSubMeshes > 1)
+		taskScheduler->ParallelFor(numSubMeshes, optimizeTask);
+	else
+		for (int s = 0; s < numSubMeshes; s++)
+			optimizeTask(s);
+
+	if (staging.spriteRemap)
+		return;
+
+	std::vector<uint32_t> remap(numVerts);
+	OptimizeVertexFetch(indices, numIndices, numVerts, remap.data());
+
+	const size_t numInfluences = staging.skin.numInfluences;
+
+	RemapVector(staging.positions, sizeof(Vector), numVerts, remap.data());
+	RemapVector(staging.normals, sizeof(Vector), numVerts, remap.data());
+
+	for (auto &channel : staging.uvChannels)
+		RemapVector(channel, sizeof(Vector), numVerts, remap.data());
+
+	RemapVector(staging.colors, sizeof(Vector), numVerts, remap.data());
+	RemapVector(staging.alpha, sizeof(float), numVerts, remap.data());
+	RemapVector(staging.skin.indices, sizeof(uchar) * numInfluences, numVerts, remap.data());
+	RemapVector(staging.skin.weights, sizeof(float) * numInfluences, numVerts, remap.data());
+	RemapVector(staging.morph.deltas, sizeof(Vector), numVerts, remap.data());
+	RemapVector(staging.morph.controlChannels, sizeof(UIVector4), numVerts, remap.data());
+	RemapVector(staging.morph.controlWeights, sizeof(Vector4), numVerts, remap.data());
+}
+
+template<class Type>
+static uint64_t HashVector(const StagingVector<Type> &vec, uint64_t seed)
+{
+	return HashBytes(vec.data(), vec.size() * sizeof(Type), seed);
+}
+
+void FingerprintMesh(MeshStaging &staging)
+{
+	const int counts[] = { staging.numVertices, staging.numFaces, static_cast<int>(staging.uvChannels.size()) };
+	uint64_t hash = HashBytes(counts, sizeof(counts), 0);
+
+	hash = HashVector(staging.positions, hash);
+	hash = HashVector(staging.normals, hash);
+
+	for (auto &channel : staging.uvChannels)
+		hash = HashVector(channel, hash);
+
+	hash = HashVector(staging.colors, hash);
+	hash = HashVector(staging.alpha, hash);
+	hash = HashVector(staging.faces, hash);
+	hash = HashVector(staging.subMeshNumFaces, hash);
+
+	staging.contentHash = hash;
+
+	const int deformCounts[] = { static_cast<int>(staging.remaps.size()), staging.spriteRemap, staging.skin.numInfluences };
+	hash = HashBytes(deformCounts, sizeof(deformCounts), 0);
+	hash = HashVector(staging.remaps, hash);
+	hash = HashVector(staging.skin.indices, hash);
+	hash = HashVector(staging.skin.weights, hash);
+	hash = HashVector(staging.morph.deltas, hash);
+	hash = HashVector(staging.morph.controlChannels, hash);
+	hash = HashVector(staging.morph.controlWeights, hash);
+
+	staging.deformHash = hash;
+}
+
+void StageMaterial(MaterialStaging &staging, AmfMaterial::Ptr material)
+{
+	staging.source = material;
+	staging.name = ToStaging(material->GetName());
+	staging.nameHash = material->GetNameHash();
+	staging.attributesHash = material->GetAttributesHash();
+	staging.pbr = material->GetMaterialType() == MaterialType_PBR;
+
+	const int numTextures = material->GetNumTextures();
+	staging.textures.reserve(numTextures);
+
+	for (int t = 0; t < numTextures; t++)
+		staging.textures.push_back(ToStaging(material->GetTexture(t)));
+
+	ReflectorPtr attributtes = material->GetReflectedAttributes();
+	const int numReflValues = attributtes ? attributtes->GetNumReflectedValues() : 0;
+	staging.attributes.reserve(numReflValues);
+
+	for (int t = 0; t < numReflValues; t++)
+	{
+		const Reflector::KVPair &pair = attributtes->GetReflectedPair(t);
+		staging.attributes.emplace_back(ToStaging(pair.name), ToStaging(pair.value));
+	}
+}
+
+bool StageModel(ModelStaging &staging, const StagingSettings &settings)
+{
+	IADF *adf = staging.adf.Get();
+	staging.header = adf->FindInstance<AmfMeshHeader>();
+	staging.model = adf->FindInstance<AmfModel>();
+
+	if (!staging.header || !staging.model)
+		return false;
+
+	const int numMaterials = staging.model->GetNumMaterials();
+	staging.materials.resize(numMaterials);
+
+	for (int m = 0; m < numMaterials; m++)
+		StageMaterial(staging.materials[m], staging.model->GetMaterial(m));
+
+	AmfMeshHeader *msh = staging.header;
+	const int numLODGroups = msh->GetNumLODs();
+	int highestDetailLOD = INT_MAX;
+	int lowestDetailLOD = 0;
+
+	for (int ld = 0; ld < numLODGroups; ld++)
+	{
+		if (msh->GetLodIndex(ld) < highestDetailLOD)
+			highestDetailLOD = msh->GetLodIndex(ld);
+
+		if (msh->GetLodIndex(ld) > lowestDetailLOD)
+			lowestDetailLOD = msh->GetLodIndex(ld);
+	}
+
+	staging.lods.reserve(numLODGroups);
+	std::vector<MeshStaging *> meshes;
+
+	for (int ld = 0; ld < numLODGroups; ld++)
+	{
+		const int lodIndex = msh->GetLodIndex(ld);
+
+		if (!settings.lodFilter.Accepts(lodIndex, highestDetailLOD, lowestDetailLOD))
+			continue;
+
+		staging.lods.emplace_back();
+		LODStaging &lod = staging.lods.back();
+		lod.lodIndex = lodIndex;
+
+		const int numLodMeshes = msh->GetNumLODMeshes(ld);
+		lod.meshes.resize(numLodMeshes);
+
+		for (int m = 0; m < numLodMeshes; m++)
+		{
+			MeshStaging &mesh = lod.meshes[m];
+			mesh.source = msh->GetLODMesh(ld, m);
+			meshes.push_back(&mesh);
+		}
+	}
+
+	auto decodeTask = [&](size_t m) { DecodeMesh(*meshes[m], settings); };
+
+	if (taskScheduler)
+		taskScheduler->ParallelFor(meshes.size(), decodeTask);
+	else
+		for (size_t m = 0; m < meshes.size(); m++)
+			decodeTask(m);
+
+	return true;
+}
+
+bool StageStuntAreas(ModelStaging &staging, const StagingSettings &settings)
+{
+	StuntAreas_wrap *are = staging.adf.Get()->FindInstance<StuntAreas_wrap>();
+
+	if (!are)
+		return false;
+
+	StuntAreas *areas = are->Data();
+
+	if (!areas->numStuntAreas)
+		return false;
+
+	staging.stuntAreas.resize(areas->numStuntAreas);
+
+	for (int a = 0; a < areas->numStuntAreas; a++)
+	{
+		StuntArea &area = areas->stuntAreas[a];
+		StuntAreaStaging &out = staging.stuntAreas[a];
+
+		out.name = area.name.string.cPtr;
+		out.partName = area.partName.string.cPtr;
+		out.vertices.resize(area.numDeformPoints);
+		out.indices.resize(area.numFaces * 3);
+
+		for (int v = 0; v < area.numDeformPoints; v++)
+			out.vertices[v] = reinterpret_cast<const Vector &>(area.vertices[v]);
+
+		ApexToMaxSpace(Floats(out.vertices), area.numDeformPoints, settings.scale);
+
+		for (int f = 0; f < area.numFaces; f++)
+			for (int i = 0; i < 3; i++)
+				out.indices[f * 3 + i] = area.faces[f][i];
+
+		importProfiler.Add(ImportCounter_Meshes);
+		importProfiler.Add(ImportCounter_Vertices, area.numDeformPoints);
+		importProfiler.Add(ImportCounter_Faces, area.numFaces);
+	}
+
+	return true;
+}
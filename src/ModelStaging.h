@@ -0,0 +1,199 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "ADFLoader.h"
+#include "ImportMemory.h"
+#include "StagingKernels.h"
+#include "datas/vectors.hpp"
+
+// Comma separated list of LOD indices, "first" selects the highest detail LOD present, "last" the lowest detail one.
+// Empty filter accepts every LOD. Rejected LODs skip decode and scene build only,
+// IADF has already read buffers of every LOD by then, so file I/O and ADF memory don't shrink.
+class LODFilter
+{
+	std::vector<int> indices;
+	bool highestDetail;
+	bool lowestDetail;
+public:
+	LODFilter() : highestDetail(false), lowestDetail(false) {}
+	void Parse(const TCHAR *filter);
+	bool Empty() const { return indices.empty() && !highestDetail && !lowestDetail; }
+	bool Accepts(int lodIndex, int highestDetailIndex, int lowestDetailIndex) const;
+};
+
+// Region of interest in Max units, staging culls meshes with bounds outside of it.
+// Culling needs decoded positions and runs after IADF has read the whole file, it saves the rest of decode and scene build.
+// Text form is "box minX minY minZ maxX maxY maxZ" or "sphere X Y Z radius", empty text disables culling.
+class StagingRegion
+{
+public:
+	enum Shape
+	{
+		Shape_None,
+		Shape_Box,
+		Shape_Sphere
+	};
+
+private:
+	Shape shape;
+	float values[6];
+
+public:
+	StagingRegion() : shape(Shape_None) {}
+
+	// Returns false for malformed text, region is disabled then.
+	bool Parse(const TCHAR *text);
+	bool Empty() const { return shape == Shape_None; }
+	bool Accepts(const Vector &boundsMin, const Vector &boundsMax) const;
+};
+
+// boundsOnly decodes positions into mesh bounds and skips every other stream.
+// headersOnly stops before positions, meshes keep names, counts and remaps, bounds stay empty and region is ignored.
+// Skipped streams are still read by IADF, only their decode, staging memory and Max meshes are saved.
+struct StagingSettings
+{
+	float scale;
+	LODFilter lodFilter;
+	StagingRegion region;
+	bool boundsOnly;
+	bool headersOnly;
+	bool optimizeMeshes;
+
+	StagingSettings() : scale(1.0f), boundsOnly(false), headersOnly(false), optimizeMeshes(false) {}
+};
+
+// Bone influences, numInfluences entries per vertex.
+// Indices point into mesh remaps.
+struct SkinStaging
+{
+	int numInfluences;
+	StagingVector<uchar> indices;
+	StagingVector<float> weights;
+
+	SkinStaging() : numInfluences(0) {}
+	bool Valid() const { return numInfluences > 0; }
+};
+
+// Deform normal morph, deltas are in 3ds Max space.
+// Meshes with control points blend 4 channels per vertex,
+// every mesh remap above 0 names a channel.
+struct MorphStaging
+{
+	StagingVector<Vector> deltas;
+	StagingVector<UIVector4> controlChannels;
+	StagingVector<Vector4> controlWeights;
+
+	bool Valid() const { return !deltas.empty(); }
+};
+
+// Decoded mesh data, already converted into 3ds Max space.
+// Everything here can be built outside of the main thread.
+// Source is null for synthetic meshes.
+// Culled meshes keep their name and bounds only.
+struct MeshStaging
+{
+	AmfMesh::Ptr source;
+	AmfMesh::DescriptorCollection descriptors;
+	StagingString name;
+	int numVertices;
+	int numFaces;
+	bool spriteRemap;
+	uint64_t contentHash;
+	uint64_t deformHash;
+	Vector boundsMin;
+	Vector boundsMax;
+	bool culled;
+
+	StagingVector<int> remaps;
+	StagingVector<ApexHash> subMeshNameHashes;
+
+	StagingVector<Vector> positions;
+	StagingVector<Vector> normals;
+	std::vector<StagingVector<Vector>> uvChannels;
+	StagingVector<Vector> colors;
+	StagingVector<float> alpha;
+
+	StagingVector<USVector> faces;
+	StagingVector<int> subMeshNumFaces;
+
+	SkinStaging skin;
+	MorphStaging morph;
+
+	MeshStaging() : numVertices(0), numFaces(0), spriteRemap(false), contentHash(0), deformHash(0), culled(false) {}
+	bool Valid() const { return numVertices > 0; }
+};
+
+struct LODStaging
+{
+	int lodIndex;
+	std::vector<MeshStaging> meshes;
+};
+
+// Source is kept for material builders, it's null for synthetic materials.
+struct MaterialStaging : MaterialIR
+{
+	AmfMaterial::Ptr source;
+};
+
+struct StuntAreaStaging
+{
+	StagingString name;
+	StagingString partName;
+	StagingVector<Vector> vertices;
+	StagingVector<int> indices;
+};
+
+// Staging vectors of one file live in its arena when it's bound during staging.
+// Arena goes last, after everything placed in it.
+struct ModelStaging
+{
+	ImportArena arena;
+	ADFHandle adf;
+	AmfMeshHeader *header;
+	AmfModel *model;
+	std::vector<LODStaging> lods;
+	std::vector<MaterialStaging> materials;
+	std::vector<StuntAreaStaging> stuntAreas;
+	TrackedVector<char, MemoryCategory_ADF> syntheticData;
+
+	ModelStaging() : header(nullptr), model(nullptr) {}
+};
+
+void DecodeMesh(MeshStaging &staging, const StagingSettings &settings);
+
+// Computes bounds from staged positions, culls the mesh when they are outside of settings region.
+// Returns true when the rest of mesh should be decoded, positions are released otherwise.
+bool StageBounds(MeshStaging &staging, const StagingSettings &settings);
+
+// Reorders triangles of every submesh for post transform cache and overdraw, then vertices in order of first use.
+// Submesh face ranges stay where they are, so do material IDs. Sprite meshes keep vertex order,
+// their skin is read by source vertex index.
+void OptimizeMesh(MeshStaging &staging);
+
+// contentHash covers everything that ends up in Max mesh.
+// Skin, morph and remaps are per node, they go into deformHash.
+void FingerprintMesh(MeshStaging &staging);
+void StageMaterial(MaterialStaging &staging, AmfMaterial::Ptr material);
+
+// Expects loaded adf, returns false when adf is not a model.
+bool StageModel(ModelStaging &staging, const StagingSettings &settings);
+
+// Expects loaded adf, returns false when adf has no stunt areas.
+bool StageStuntAreas(ModelStaging &staging, const StagingSettings &settings);
@@ -0,0 +1,656 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Measures mesh staging throughput over synthetic vertex streams.
+// Usage: StagingBench [-verts N] [-runs N] [-materials N] [-model FILE]...
+// Synthetic cases unpack streams with a private decoder, then run the staging kernel on it.
+// They are reported with "kernel" decoder, AmfVertexDescriptor::Evaluate isn't part of them,
+// ApexLib only builds descriptors over buffers of a parsed ADF.
+// Built with ApexLib, -model adds "ApexLib" cases that time Evaluate over every vertex stream of real meshes,
+// then DecodeMesh over every mesh and StageMaterial over every material, the paths import takes.
+
+#include "StagingKernels.h"
+#ifdef STAGING_BENCH_APEXLIB
+#include "ModelStaging.h"
+#include "datas/vectors.hpp"
+#include <map>
+#endif
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+// Vertex stream packings found in Apex meshes.
+enum BenchFormat
+{
+	BenchFormat_R32G32B32_FLOAT,
+	BenchFormat_R16G16B16A16_SNORM,
+	BenchFormat_R8G8B8A8_UNORM,
+	BenchFormat_R10G10B10A2_UNORM,
+	BenchFormat_R32G32_FLOAT,
+	BenchFormat_R16G16_SNORM,
+	BenchFormat_R16G16_FLOAT,
+	BenchFormat_R32_UNIT_VEC_AS_FLOAT,
+};
+
+static const char *formatNames[] =
+{
+	"R32G32B32_FLOAT",
+	"R16G16B16A16_SNORM",
+	"R8G8B8A8_UNORM",
+	"R10G10B10A2_UNORM",
+	"R32G32_FLOAT",
+	"R16G16_SNORM",
+	"R16G16_FLOAT",
+	"R32_UNIT_VEC_AS_FLOAT",
+};
+
+static const size_t formatStrides[] = { 12, 8, 4, 4, 8, 4, 4, 4 };
+
+static float HalfToFloat(uint16_t half)
+{
+	const uint32_t sign = (half >> 15) & 1;
+	const int exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+
+	if (!exponent)
+		return (sign ? -1.0f : 1.0f) * std::ldexp(static_cast<float>(mantissa), -24);
+
+	return (sign ? -1.0f : 1.0f) * std::ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+}
+
+// Unpacks numComponents floats from every element of a packed stream.
+static void EvaluateStream(BenchFormat format, const char *data, size_t count, float *out, int numComponents)
+{
+	for (size_t v = 0; v < count; v++, out += numComponents)
+	{
+		const char *element = data + v * formatStrides[format];
+
+		switch (format)
+		{
+		case BenchFormat_R32G32B32_FLOAT:
+		case BenchFormat_R32G32_FLOAT:
+			memcpy(out, element, numComponents * sizeof(float));
+			break;
+		case BenchFormat_R16G16B16A16_SNORM:
+		case BenchFormat_R16G16_SNORM:
+		{
+			int16_t comps[4];
+			memcpy(comps, element, formatStrides[format]);
+
+			for (int c = 0; c < numComponents; c++)
+				out[c] = comps[c] * (1.0f / 32767.0f);
+			break;
+		}
+		case BenchFormat_R8G8B8A8_UNORM:
+			for (int c = 0; c < numComponents; c++)
+				out[c] = static_cast<uint8_t>(element[c]) * (1.0f / 255.0f);
+			break;
+		case BenchFormat_R10G10B10A2_UNORM:
+		{
+			uint32_t packed;
+			memcpy(&packed, element, sizeof(packed));
+
+			for (int c = 0; c < numComponents; c++)
+				out[c] = c < 3 ? ((packed >> (c * 10)) & 0x3ff) * (2.0f / 1023.0f) - 1.0f : (packed >> 30) * (1.0f / 3.0f);
+			break;
+		}
+		case BenchFormat_R16G16_FLOAT:
+		{
+			uint16_t comps[2];
+			memcpy(comps, element, sizeof(comps));
+			out[0] = HalfToFloat(comps[0]);
+			out[1] = HalfToFloat(comps[1]);
+			break;
+		}
+		case BenchFormat_R32_UNIT_VEC_AS_FLOAT:
+		{
+			float packed;
+			memcpy(&packed, element, sizeof(packed));
+
+			for (int c = 0; c < numComponents; c++)
+			{
+				out[c] = packed - floorf(packed);
+				packed *= 256.0f;
+			}
+			break;
+		}
+		}
+	}
+}
+
+static std::vector<char> BuildStream(BenchFormat format, size_t count, std::mt19937 &rng)
+{
+	std::vector<char> data(count * formatStrides[format]);
+
+	if (format == BenchFormat_R32G32B32_FLOAT || format == BenchFormat_R32G32_FLOAT || format == BenchFormat_R32_UNIT_VEC_AS_FLOAT)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		float *floats = reinterpret_cast<float *>(data.data());
+
+		for (size_t f = 0; f < data.size() / sizeof(float); f++)
+			floats[f] = dist(rng);
+	}
+	else
+	{
+		for (auto &c : data)
+			c = static_cast<char>(rng());
+	}
+
+	return data;
+}
+
+struct BenchResult
+{
+	std::string stage;
+	std::string format;
+	size_t numItems; // vertices, triangles for vertexcache stage, materials for material stage
+	size_t numBytes;
+	double seconds;
+	const char *decoder;
+};
+
+static std::vector<BenchResult> results;
+
+static void Measure(const char *stage, const char *format, size_t numItems, size_t numBytes, int numRuns, const std::function<void()> &func,
+	const char *decoder = "kernel")
+{
+	double bestTime = 1e30;
+
+	for (int r = 0; r < numRuns; r++)
+	{
+		const Clock::time_point start = Clock::now();
+		func();
+		const double curTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (curTime < bestTime)
+			bestTime = curTime;
+	}
+
+	results.push_back({ stage, format, numItems, numBytes, bestTime, decoder });
+}
+
+#ifdef STAGING_BENCH_APEXLIB
+// Times AmfVertexDescriptor::Evaluate over every stream of every mesh, grouped by usage and format.
+static bool MeasureModel(const char *fileName, int numRuns)
+{
+	ADFHandle adf;
+
+	if (!adf.Load(fileName))
+		return false;
+
+	AmfMeshHeader *header = adf->FindInstance<AmfMeshHeader>();
+
+	if (!header)
+		return false;
+
+	typedef std::pair<int, int> StreamKey;
+	std::map<StreamKey, std::vector<std::pair<AmfVertexDescriptor *, int>>> streams;
+	std::vector<AmfMesh::Ptr> meshes;
+	std::vector<AmfMesh::DescriptorCollection> descriptors;
+	int maxVertices = 0;
+
+	for (int ld = 0; ld < header->GetNumLODs(); ld++)
+		for (int m = 0; m < header->GetNumLODMeshes(ld); m++)
+		{
+			AmfMesh::Ptr mesh = header->GetLODMesh(ld, m);
+
+			if (!mesh->IsValid())
+				continue;
+
+			const int numVerts = mesh->GetNumVertices();
+			maxVertices = numVerts > maxVertices ? numVerts : maxVertices;
+			meshes.push_back(mesh);
+			descriptors.push_back(mesh->GetDescriptors());
+
+			for (auto &d : descriptors.back())
+				streams[StreamKey(static_cast<int>(d->usage), static_cast<int>(d->format))].emplace_back(d.get(), numVerts);
+		}
+
+	std::vector<Vector4> out(maxVertices);
+	char formatName[64];
+
+	for (auto &s : streams)
+	{
+		size_t numItems = 0;
+
+		for (auto &d : s.second)
+			numItems += d.second;
+
+		snprintf(formatName, sizeof(formatName), "usage %i, format %i", s.first.first, s.first.second);
+
+		Measure("evaluate", formatName, numItems, numItems * sizeof(Vector4), numRuns, [&]()
+		{
+			for (auto &d : s.second)
+				for (int v = 0; v < d.second; v++)
+					d.first->Evaluate(v, &out[v]);
+		}, "ApexLib");
+	}
+
+	size_t numVertices = 0;
+
+	for (auto &m : meshes)
+		numVertices += m->GetNumVertices();
+
+	// Every run stages into a fresh arena like a single file import does.
+	ImportArena arena;
+	StagingSettings settings;
+
+	Measure("decodemesh", fileName, numVertices, 0, numRuns, [&]()
+	{
+		arena.Release();
+		ScopedArena bound(&arena);
+		std::vector<MeshStaging> staged(meshes.size());
+
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			staged[m].source = meshes[m];
+			DecodeMesh(staged[m], settings);
+		}
+	}, "ApexLib");
+
+	AmfModel *model = adf->FindInstance<AmfModel>();
+
+	if (!model || !model->GetNumMaterials())
+		return true;
+
+	const int numMaterials = model->GetNumMaterials();
+
+	Measure("materials", fileName, numMaterials, 0, numRuns, [&]()
+	{
+		arena.Release();
+		ScopedArena bound(&arena);
+		std::vector<MaterialStaging> staged(numMaterials);
+
+		for (int m = 0; m < numMaterials; m++)
+			StageMaterial(staged[m], model->GetMaterial(m));
+	}, "ApexLib");
+
+	return true;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	size_t numVerts = 1000000;
+	size_t numMaterials = 10000;
+	int numRuns = 5;
+	std::vector<const char *> models;
+
+	for (int a = 1; a < argc; a++)
+	{
+		if (!strcmp(argv[a], "-verts") && a + 1 < argc)
+			numVerts = strtoul(argv[++a], nullptr, 10);
+		else if (!strcmp(argv[a], "-runs") && a + 1 < argc)
+			numRuns = atoi(argv[++a]);
+		else if (!strcmp(argv[a], "-materials") && a + 1 < argc)
+			numMaterials = strtoul(argv[++a], nullptr, 10);
+		else if (!strcmp(argv[a], "-model") && a + 1 < argc)
+			models.push_back(argv[++a]);
+	}
+
+	std::mt19937 rng(1234);
+	std::vector<float> floats3(numVerts * 3);
+	std::vector<float> floats4(numVerts * 4);
+	std::vector<float> floats2(numVerts * 2);
+	std::vector<float> alpha(numVerts);
+
+	static const BenchFormat positionFormats[] = { BenchFormat_R32G32B32_FLOAT, BenchFormat_R16G16B16A16_SNORM };
+	static const BenchFormat normalFormats[] = { BenchFormat_R32G32B32_FLOAT, BenchFormat_R8G8B8A8_UNORM, BenchFormat_R10G10B10A2_UNORM };
+	static const BenchFormat uvFormats[] = { BenchFormat_R32G32_FLOAT, BenchFormat_R16G16_SNORM, BenchFormat_R16G16_FLOAT };
+	static const BenchFormat colorFormats[] = { BenchFormat_R8G8B8A8_UNORM, BenchFormat_R32_UNIT_VEC_AS_FLOAT };
+
+	for (BenchFormat f : positionFormats)
+	{
+		const std::vector<char> stream = BuildStream(f, numVerts, rng);
+		Measure("positions", formatNames[f], numVerts, stream.size(), numRuns, [&]()
+		{
+			EvaluateStream(f, stream.data(), numVerts, floats3.data(), 3);
+			ApexToMaxSpace(floats3.data(), numVerts, 145.0f);
+		});
+	}
+
+	for (BenchFormat f : normalFormats)
+	{
+		const std::vector<char> stream = BuildStream(f, numVerts, rng);
+		Measure("normals", formatNames[f], numVerts, stream.size(), numRuns, [&]()
+		{
+			EvaluateStream(f, stream.data(), numVerts, floats3.data(), 3);
+			ApexToMaxSpace(floats3.data(), numVerts, 1.0f);
+		});
+	}
+
+	for (BenchFormat f : uvFormats)
+	{
+		const std::vector<char> stream = BuildStream(f, numVerts, rng);
+		Measure("uvs", formatNames[f], numVerts, stream.size(), numRuns, [&]()
+		{
+			EvaluateStream(f, stream.data(), numVerts, floats2.data(), 2);
+			ExpandUVs(floats2.data(), floats3.data(), numVerts, 1.0f, 1.0f);
+		});
+	}
+
+	for (BenchFormat f : colorFormats)
+	{
+		const std::vector<char> stream = BuildStream(f, numVerts, rng);
+		const bool packedRGB = f == BenchFormat_R32_UNIT_VEC_AS_FLOAT;
+		Measure("colors", formatNames[f], numVerts, stream.size(), numRuns, [&]()
+		{
+			if (packedRGB)
+				EvaluateStream(f, stream.data(), numVerts, floats3.data(), 3);
+			else
+			{
+				EvaluateStream(f, stream.data(), numVerts, floats4.data(), 4);
+				SplitAlpha(floats4.data(), floats3.data(), alpha.data(), numVerts);
+			}
+		});
+	}
+
+	// 1 influence has bone indices only, more use 4 wide index and weight sets.
+	// Influences that don't fill a set have zero weights in the unused lanes, like exported files.
+	for (int numInfluences = 1; numInfluences <= 8; numInfluences++)
+	{
+		const int numSets = (numInfluences + 3) / 4;
+		std::vector<std::vector<char>> indexStreams, weightStreams;
+		std::vector<std::vector<float>> weightFloats(numSets, std::vector<float>(numVerts * 4));
+		const size_t outWidth = numInfluences == 1 ? 1 : numSets * 4;
+		std::vector<uint8_t> outIndices(numVerts * outWidth);
+		std::vector<float> outWeights(numVerts * outWidth);
+		const uint8_t *indexPtrs[2];
+		const float *weightPtrs[2];
+		size_t numBytes = 0;
+
+		for (int d = 0; d < numSets; d++)
+		{
+			indexStreams.push_back(BuildStream(BenchFormat_R8G8B8A8_UNORM, numVerts, rng));
+			weightStreams.push_back(BuildStream(BenchFormat_R8G8B8A8_UNORM, numVerts, rng));
+
+			for (int s = numInfluences - d * 4; s < 4; s++)
+				for (size_t v = 0; v < numVerts; v++)
+					weightStreams[d][v * 4 + s] = 0;
+
+			indexPtrs[d] = reinterpret_cast<const uint8_t *>(indexStreams[d].data());
+			weightPtrs[d] = weightFloats[d].data();
+			numBytes += indexStreams[d].size() + (numInfluences > 1 ? weightStreams[d].size() : 0);
+		}
+
+		char formatName[32];
+		snprintf(formatName, sizeof(formatName), "%i influence(s)", numInfluences);
+
+		Measure("skin", formatName, numVerts, numBytes, numRuns, [&]()
+		{
+			if (numInfluences == 1)
+			{
+				for (size_t v = 0; v < numVerts; v++)
+					outIndices[v] = indexStreams[0][v * 4];
+
+				std::fill(outWeights.begin(), outWeights.end(), 1.0f);
+				return;
+			}
+
+			for (int d = 0; d < numSets; d++)
+				EvaluateStream(BenchFormat_R8G8B8A8_UNORM, weightStreams[d].data(), numVerts, weightFloats[d].data(), 4);
+
+			FlattenInfluences(indexPtrs, weightPtrs, numSets, numVerts, outIndices.data(), outWeights.data());
+		});
+	}
+
+	{
+		const std::vector<char> deform = BuildStream(BenchFormat_R32G32B32_FLOAT, numVerts, rng);
+		const std::vector<char> points = BuildStream(BenchFormat_R8G8B8A8_UNORM, numVerts, rng);
+		std::vector<uint32_t> channels(numVerts * 4);
+		std::vector<float> weights(numVerts * 4);
+
+		Measure("morph", "deform", numVerts, deform.size(), numRuns, [&]()
+		{
+			EvaluateStream(BenchFormat_R32G32B32_FLOAT, deform.data(), numVerts, floats3.data(), 3);
+			ApexToMaxSpace(floats3.data(), numVerts, 2.0f);
+		});
+
+		Measure("morph", "deform + control points", numVerts, deform.size() + points.size(), numRuns, [&]()
+		{
+			EvaluateStream(BenchFormat_R32G32B32_FLOAT, deform.data(), numVerts, floats3.data(), 3);
+			ApexToMaxSpace(floats3.data(), numVerts, 2.0f);
+			EvaluateStream(BenchFormat_R8G8B8A8_UNORM, points.data(), numVerts, floats4.data(), 4);
+			DecodeControlPoints(floats4.data(), channels.data(), weights.data(), numVerts);
+		});
+	}
+
+	// Instancing fingerprint over position, normal and uv streams of a staged mesh.
+	{
+		const std::vector<char> stream = BuildStream(BenchFormat_R32G32B32_FLOAT, numVerts * 3, rng);
+
+		Measure("fingerprint", "float", numVerts, stream.size(), numRuns, [&]()
+		{
+			const uint64_t hash = HashBytes(stream.data(), stream.size(), 0);
+			floats3[0] = static_cast<float>(hash & 0xff);
+		});
+	}
+
+	// Proxy bounds over max space positions, plain loop is kept as a baseline for the SSE reduction.
+	{
+		for (auto &f : floats3)
+			f = static_cast<float>(rng() % 2000) - 1000.0f;
+
+		float bmin[3], bmax[3];
+
+		Measure("bounds", "kernel", numVerts, numVerts * sizeof(float) * 3, numRuns, [&]()
+		{
+			ComputeBounds(floats3.data(), numVerts, bmin, bmax);
+		});
+
+		Measure("bounds", "scalar", numVerts, numVerts * sizeof(float) * 3, numRuns, [&]()
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				bmin[a] = FLT_MAX;
+				bmax[a] = -FLT_MAX;
+			}
+
+			for (size_t v = 0; v < numVerts; v++)
+				for (int a = 0; a < 3; a++)
+				{
+					const float value = floats3[v * 3 + a];
+					bmin[a] = value < bmin[a] ? value : bmin[a];
+					bmax[a] = value > bmax[a] ? value : bmax[a];
+				}
+		});
+	}
+
+	// Submesh index buffers are flattened into one face list.
+	static const int subMeshCounts[] = { 1, 8, 64 };
+	const size_t numIndices = numVerts * 6;
+
+	for (int numSubMeshes : subMeshCounts)
+	{
+		std::vector<uint16_t> indices(numIndices);
+		std::vector<uint16_t> faces;
+		const size_t subMeshSize = numIndices / numSubMeshes / 3 * 3;
+
+		for (auto &i : indices)
+			i = static_cast<uint16_t>(rng());
+
+		char formatName[32];
+		snprintf(formatName, sizeof(formatName), "%i submesh(es)", numSubMeshes);
+
+		Measure("indices", formatName, numVerts, numIndices * sizeof(uint16_t), numRuns, [&]()
+		{
+			faces.clear();
+			faces.reserve(numIndices);
+
+			for (int s = 0; s < numSubMeshes; s++)
+				faces.insert(faces.end(), indices.begin() + s * subMeshSize, indices.begin() + (s + 1) * subMeshSize);
+		});
+	}
+
+	// Triangle reordering on a 16 bit indexed grid, triangles and vertices get shuffled first like a badly exported mesh.
+	{
+		const size_t gridSide = 256;
+		const size_t numGridVerts = gridSide * gridSide;
+		std::vector<float> gridPositions(numGridVerts * 3);
+		std::vector<uint32_t> vertexOrder(numGridVerts);
+		std::vector<uint16_t> source;
+
+		for (size_t v = 0; v < numGridVerts; v++)
+			vertexOrder[v] = static_cast<uint32_t>(v);
+
+		std::shuffle(vertexOrder.begin(), vertexOrder.end(), rng);
+
+		for (size_t y = 0; y < gridSide; y++)
+			for (size_t x = 0; x < gridSide; x++)
+			{
+				float *pos = gridPositions.data() + vertexOrder[y * gridSide + x] * 3;
+				pos[0] = static_cast<float>(x);
+				pos[1] = static_cast<float>(y);
+				pos[2] = sinf(x * 0.1f) * cosf(y * 0.1f) * 4.0f;
+			}
+
+		std::vector<std::array<uint16_t, 3>> triangles;
+
+		for (size_t y = 0; y + 1 < gridSide; y++)
+			for (size_t x = 0; x + 1 < gridSide; x++)
+			{
+				const uint16_t v0 = static_cast<uint16_t>(vertexOrder[y * gridSide + x]);
+				const uint16_t v1 = static_cast<uint16_t>(vertexOrder[y * gridSide + x + 1]);
+				const uint16_t v2 = static_cast<uint16_t>(vertexOrder[(y + 1) * gridSide + x]);
+				const uint16_t v3 = static_cast<uint16_t>(vertexOrder[(y + 1) * gridSide + x + 1]);
+				triangles.push_back({ { v0, v1, v2 } });
+				triangles.push_back({ { v2, v1, v3 } });
+			}
+
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+
+		for (auto &t : triangles)
+			source.insert(source.end(), t.begin(), t.end());
+
+		const size_t numTriangles = triangles.size();
+		const double sourceACMR = VertexCacheACMR(source.data(), source.size(), numGridVerts, 16);
+		std::vector<uint16_t> indices;
+		std::vector<uint32_t> remap(numGridVerts);
+		char formatName[64];
+
+		auto optimize = [&](bool overdraw, bool fetch)
+		{
+			indices = source;
+			OptimizeVertexCache(indices.data(), indices.size(), numGridVerts);
+
+			if (overdraw)
+				OptimizeOverdraw(indices.data(), indices.size(), gridPositions.data(), numGridVerts);
+
+			if (fetch)
+			{
+				OptimizeVertexFetch(indices.data(), indices.size(), numGridVerts, remap.data());
+				RemapVertexStream(gridPositions.data(), sizeof(float) * 3, numGridVerts, remap.data());
+			}
+		};
+
+		// ACMR goes into format names, runs are timed after it's known.
+		optimize(false, false);
+		snprintf(formatName, sizeof(formatName), "forsyth, ACMR %.3f -> %.3f", sourceACMR,
+			VertexCacheACMR(indices.data(), indices.size(), numGridVerts, 16));
+		Measure("vertexcache", formatName, numTriangles, source.size() * sizeof(uint16_t), numRuns, [&]() { optimize(false, false); });
+
+		optimize(true, false);
+		snprintf(formatName, sizeof(formatName), "forsyth + overdraw, ACMR %.3f -> %.3f", sourceACMR,
+			VertexCacheACMR(indices.data(), indices.size(), numGridVerts, 16));
+		Measure("vertexcache", formatName, numTriangles, source.size() * sizeof(uint16_t), numRuns, [&]() { optimize(true, false); });
+
+		// Positions get remapped on every run, fetch order doesn't change simulated cache hits.
+		Measure("vertexcache", "forsyth + overdraw + fetch", numTriangles, source.size() * sizeof(uint16_t) + gridPositions.size() * sizeof(float),
+			numRuns, [&]() { optimize(true, true); });
+	}
+
+	{
+		std::vector<MaterialIR> materials;
+		char text[64];
+		ImportArena arena;
+
+		auto stageMaterials = [&]()
+		{
+			materials.resize(numMaterials);
+
+			for (size_t m = 0; m < numMaterials; m++)
+			{
+				MaterialIR &mat = materials[m];
+				snprintf(text, sizeof(text), "material_%zu", m);
+				mat.name = text;
+				mat.nameHash = static_cast<uint32_t>(m * 2654435761u);
+				mat.attributesHash = 0x3E5E3F09;
+				mat.pbr = (m & 1) != 0;
+
+				for (int t = 0; t < 8; t++)
+				{
+					snprintf(text, sizeof(text), "textures/environment/material_%zu_%i.ddsc", m, t);
+					mat.textures.emplace_back(text);
+				}
+
+				for (int t = 0; t < 20; t++)
+				{
+					snprintf(text, sizeof(text), "%f", t * 0.25f);
+					mat.attributes.emplace_back("attribute", text);
+				}
+			}
+		};
+
+		// Material strings come from heap without a bound arena, import binds one per file.
+		Measure("materials", "MaterialIR, heap", numMaterials, 0, numRuns, [&]()
+		{
+			materials.clear();
+			stageMaterials();
+		});
+
+		Measure("materials", "MaterialIR, arena", numMaterials, 0, numRuns, [&]()
+		{
+			materials.clear();
+			arena.Release();
+			ScopedArena bound(&arena);
+			stageMaterials();
+		});
+
+		materials.clear();
+	}
+
+	for (const char *fileName : models)
+	{
+#ifdef STAGING_BENCH_APEXLIB
+		if (!MeasureModel(fileName, numRuns))
+			fprintf(stderr, "%s: couldn't load model.\n", fileName);
+#else
+		fprintf(stderr, "%s: skipped, built without ApexLib.\n", fileName);
+#endif
+	}
+
+	printf("{\n\t\"numVertices\": %zu,\n\t\"runs\": %i,\n\t\"results\": [", numVerts, numRuns);
+
+	for (size_t r = 0; r < results.size(); r++)
+	{
+		const BenchResult &res = results[r];
+		printf("%s\n\t\t{\"stage\": \"%s\", \"format\": \"%s\", \"decoder\": \"%s\", \"items\": %zu, \"seconds\": %.6f, \"Mitemsps\": %.2f, \"MBps\": %.2f}",
+			r ? "," : "", res.stage.c_str(), res.format.c_str(), res.decoder, res.numItems, res.seconds,
+			res.numItems / res.seconds * 1e-6, res.numBytes / res.seconds / (1024.0 * 1024.0));
+	}
+
+	printf("\n\t]\n}\n");
+
+	return 0;
+}
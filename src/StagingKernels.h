@@ -0,0 +1,580 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define STAGING_KERNELS_SSE
+#include <xmmintrin.h>
+#endif
+#include <vector>
+#include "ImportMemory.h"
+
+// Bulk transforms applied to evaluated vertex streams during staging.
+// Plain float arrays only, so benchmarks can run them without ApexLib.
+
+// Host independent part of a staged material, strings live in the bound import arena.
+struct MaterialIR
+{
+	StagingString name;
+	uint32_t nameHash;
+	uint32_t attributesHash;
+	bool pbr;
+	StagingVector<StagingString> textures;
+	StagingVector<std::pair<StagingString, StagingString>> attributes;
+};
+
+// Apex Y up into Max Z up, same as corMat.VectorTransform, xyz triplets in place.
+inline void ApexToMaxSpace(float *xyz, size_t count, float scale)
+{
+	for (size_t v = 0; v < count; v++, xyz += 3)
+	{
+		const float x = xyz[0], y = xyz[1], z = xyz[2];
+		xyz[0] = -x * scale;
+		xyz[1] = z * scale;
+		xyz[2] = y * scale;
+	}
+}
+
+// uv pairs into uvw triplets with V flipped.
+inline void ExpandUVs(const float *uv, float *uvw, size_t count, float packX, float packY)
+{
+	for (size_t v = 0; v < count; v++, uv += 2, uvw += 3)
+	{
+		uvw[0] = uv[0] * packX;
+		uvw[1] = 1.0f - uv[1] * packY;
+		uvw[2] = 0.0f;
+	}
+}
+
+// rgba quads into rgb triplets and separate alpha.
+inline void SplitAlpha(const float *rgba, float *rgb, float *alpha, size_t count)
+{
+	for (size_t v = 0; v < count; v++, rgba += 4, rgb += 3)
+	{
+		rgb[0] = rgba[0];
+		rgb[1] = rgba[1];
+		rgb[2] = rgba[2];
+		alpha[v] = rgba[3];
+	}
+}
+
+// Deform control points pack 4 signed channel indices with fractional weights.
+inline void DecodeControlPoints(const float *cpoints, uint32_t *channels, float *weights, size_t count)
+{
+	for (size_t i = 0; i < count * 4; i++)
+	{
+		const float index = cpoints[i] * 127.996f;
+		const float indexFloored = floorf(index);
+		channels[i] = static_cast<uint32_t>(static_cast<int>(indexFloored) + 128);
+		weights[i] = index - indexFloored;
+	}
+}
+
+// Interleaves numSets of 4 influence streams into numSets * 4 influences per vertex.
+inline void FlattenInfluences(const uint8_t *const *indexSets, const float *const *weightSets, int numSets,
+	size_t count, uint8_t *outIndices, float *outWeights)
+{
+	const size_t numInfluences = numSets * 4;
+
+	for (int d = 0; d < numSets; d++)
+	{
+		const uint8_t *indices = indexSets[d];
+		const float *weights = weightSets[d];
+
+		for (size_t v = 0; v < count; v++)
+			for (int s = 0; s < 4; s++)
+			{
+				outIndices[v * numInfluences + d * 4 + s] = indices[v * 4 + s];
+				outWeights[v * numInfluences + d * 4 + s] = weights[v * 4 + s];
+			}
+	}
+}
+
+// Axis aligned bounds of xyz triplets, empty input gives FLT_MAX minimum and -FLT_MAX maximum.
+// 4 vertices are 3 SSE registers laid out xyzx yzxy zxyz, lanes are folded into axes once at the end.
+inline void ComputeBounds(const float *xyz, size_t count, float *outMin, float *outMax)
+{
+	float bmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float bmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	size_t v = 0;
+
+#ifdef STAGING_KERNELS_SSE
+	if (count >= 4)
+	{
+		__m128 minA = _mm_loadu_ps(xyz), minB = _mm_loadu_ps(xyz + 4), minC = _mm_loadu_ps(xyz + 8);
+		__m128 maxA = minA, maxB = minB, maxC = minC;
+
+		for (v = 4; v + 4 <= count; v += 4)
+		{
+			const float *quad = xyz + v * 3;
+			const __m128 a = _mm_loadu_ps(quad), b = _mm_loadu_ps(quad + 4), c = _mm_loadu_ps(quad + 8);
+			minA = _mm_min_ps(minA, a);
+			minB = _mm_min_ps(minB, b);
+			minC = _mm_min_ps(minC, c);
+			maxA = _mm_max_ps(maxA, a);
+			maxB = _mm_max_ps(maxB, b);
+			maxC = _mm_max_ps(maxC, c);
+		}
+
+		float lanes[2][12];
+		_mm_storeu_ps(lanes[0], minA);
+		_mm_storeu_ps(lanes[0] + 4, minB);
+		_mm_storeu_ps(lanes[0] + 8, minC);
+		_mm_storeu_ps(lanes[1], maxA);
+		_mm_storeu_ps(lanes[1] + 4, maxB);
+		_mm_storeu_ps(lanes[1] + 8, maxC);
+
+		for (int l = 0; l < 12; l++)
+		{
+			const int axis = l % 3;
+
+			if (lanes[0][l] < bmin[axis])
+				bmin[axis] = lanes[0][l];
+
+			if (lanes[1][l] > bmax[axis])
+				bmax[axis] = lanes[1][l];
+		}
+	}
+#endif
+
+	for (; v < count; v++)
+		for (int a = 0; a < 3; a++)
+		{
+			const float value = xyz[v * 3 + a];
+
+			if (value < bmin[a])
+				bmin[a] = value;
+
+			if (value > bmax[a])
+				bmax[a] = value;
+		}
+
+	for (int a = 0; a < 3; a++)
+	{
+		outMin[a] = bmin[a];
+		outMax[a] = bmax[a];
+	}
+}
+
+// Content fingerprint of a byte stream, chain hashes by passing previous result as seed.
+// Word at a time multiply mix, not meant to be cryptographic.
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+{
+	static const uint64_t prime = 0x9E3779B97F4A7C15ull;
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	uint64_t hash = seed ^ (size * prime);
+	size_t b = 0;
+
+	for (; b + sizeof(uint64_t) <= size; b += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, bytes + b, sizeof(word));
+		word *= prime;
+		word ^= word >> 32;
+		hash = (hash ^ word) * prime;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, bytes + b, size - b);
+	hash = (hash ^ tail) * prime;
+	hash ^= hash >> 29;
+
+	return hash;
+}
+
+// Average cache miss ratio of an index list, misses per triangle on a FIFO post transform cache.
+// 0.5 is the best a regular grid can get, 3 means every vertex gets transformed for every triangle.
+inline double VertexCacheACMR(const uint16_t *indices, size_t numIndices, size_t numVertices, unsigned cacheSize)
+{
+	if (numIndices < 3)
+		return 0.0;
+
+	std::vector<size_t> timestamps(numVertices, 0);
+	size_t time = cacheSize + 1;
+	size_t numMisses = 0;
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		const uint16_t index = indices[i];
+
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			numMisses++;
+		}
+	}
+
+	return static_cast<double>(numMisses) / static_cast<double>(numIndices / 3);
+}
+
+// Forsyth's linear speed vertex cache optimisation, reorders triangles of an index list in place.
+// Indices can point anywhere below numVertices, so submeshes of a shared vertex buffer work as they are.
+inline void OptimizeVertexCache(uint16_t *indices, size_t numIndices, size_t numVertices)
+{
+	static const int cacheSize = 32;
+	static const int maxValence = 32;
+	const size_t numTris = numIndices / 3;
+
+	if (numTris < 2)
+		return;
+
+	float cacheScores[cacheSize];
+	float valenceScores[maxValence];
+
+	for (int c = 0; c < cacheSize; c++)
+		cacheScores[c] = c < 3 ? 0.75f : powf(1.0f - static_cast<float>(c - 3) / (cacheSize - 3), 1.5f);
+
+	for (int v = 0; v < maxValence; v++)
+		valenceScores[v] = v ? 2.0f / sqrtf(static_cast<float>(v)) : 0.0f;
+
+	std::vector<uint32_t> valences(numVertices, 0);
+
+	for (size_t i = 0; i < numTris * 3; i++)
+		valences[indices[i]]++;
+
+	// Triangles adjacent to every vertex, remaining ones are kept at front of each range.
+	std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+
+	for (size_t v = 0; v < numVertices; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valences[v];
+
+	std::vector<uint32_t> adjacency(numTris * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (size_t t = 0; t < numTris; t++)
+		for (int c = 0; c < 3; c++)
+			adjacency[fill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+
+	std::vector<int> cachePositions(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+
+	auto vertexScore = [&](uint32_t vertex)
+	{
+		const uint32_t valence = valences[vertex];
+
+		if (!valence)
+			return -1.0f;
+
+		const int position = cachePositions[vertex];
+		const float cacheScore = position < 0 ? 0.0f : cacheScores[position];
+
+		return cacheScore + (valence < maxValence ? valenceScores[valence] : 2.0f / sqrtf(static_cast<float>(valence)));
+	};
+
+	for (size_t v = 0; v < numVertices; v++)
+		vertexScores[v] = vertexScore(static_cast<uint32_t>(v));
+
+	std::vector<float> triangleScores(numTris);
+	std::vector<bool> emitted(numTris, false);
+	size_t bestTriangle = 0;
+
+	for (size_t t = 0; t < numTris; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = t;
+	}
+
+	std::vector<uint16_t> output(numTris * 3);
+	uint32_t cache[cacheSize + 3];
+	uint32_t newCache[cacheSize + 3];
+	int cacheCount = 0;
+	size_t cursor = 0;
+
+	for (size_t o = 0; o < numTris; o++)
+	{
+		// Dead end, nothing in cache has triangles left, continue with the next unused one in source order.
+		if (bestTriangle == ~size_t(0))
+		{
+			while (emitted[cursor])
+				cursor++;
+
+			bestTriangle = cursor;
+		}
+
+		const uint16_t *tri = indices + bestTriangle * 3;
+		int newCount = 0;
+
+		emitted[bestTriangle] = true;
+
+		for (int c = 0; c < 3; c++)
+		{
+			const uint16_t vertex = tri[c];
+			output[o * 3 + c] = vertex;
+			newCache[newCount++] = vertex;
+
+			uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+			uint32_t *end = begin + valences[vertex];
+
+			for (uint32_t *a = begin; a < end; a++)
+				if (*a == bestTriangle)
+				{
+					*a = *(end - 1);
+					break;
+				}
+
+			valences[vertex]--;
+		}
+
+		for (int c = 0; c < cacheCount; c++)
+		{
+			const uint32_t vertex = cache[c];
+
+			if (vertex != tri[0] && vertex != tri[1] && vertex != tri[2])
+				newCache[newCount++] = vertex;
+		}
+
+		// Vertices pushed out of cache lose their position, then every touched vertex is rescored.
+		for (int c = cacheSize; c < newCount; c++)
+			cachePositions[newCache[c]] = -1;
+
+		const int keptCount = newCount < cacheSize ? newCount : cacheSize;
+
+		for (int c = 0; c < keptCount; c++)
+			cachePositions[newCache[c]] = c;
+
+		for (int c = 0; c < newCount; c++)
+		{
+			const uint32_t vertex = newCache[c];
+			const float newScore = vertexScore(vertex);
+			const float delta = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+
+			const uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+			const uint32_t *end = begin + valences[vertex];
+
+			for (const uint32_t *a = begin; a < end; a++)
+				triangleScores[*a] += delta;
+		}
+
+		// Next triangle comes from ones touching the cache.
+		bestTriangle = ~size_t(0);
+		float bestScore = -FLT_MAX;
+
+		for (int c = 0; c < keptCount; c++)
+		{
+			const uint32_t vertex = newCache[c];
+			const uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+			const uint32_t *end = begin + valences[vertex];
+
+			for (const uint32_t *a = begin; a < end; a++)
+				if (triangleScores[*a] > bestScore)
+				{
+					bestScore = triangleScores[*a];
+					bestTriangle = *a;
+				}
+		}
+
+		memcpy(cache, newCache, keptCount * sizeof(uint32_t));
+		cacheCount = keptCount;
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(uint16_t));
+}
+
+// Reorders cache optimized triangles for less overdraw, xyz are positions of numVertices vertices.
+// Hard clusters split where a triangle misses the cache on every vertex, those are split further
+// wherever the part so far is about as cache efficient as the whole, so ACMR grows by 5% at most.
+// Clusters facing away from mesh center go first, they tend to occlude the rest.
+inline void OptimizeOverdraw(uint16_t *indices, size_t numIndices, const float *xyz, size_t numVertices)
+{
+	static const size_t cacheSize = 16;
+	static const float threshold = 1.05f;
+	const size_t numTris = numIndices / 3;
+
+	if (numTris < 2)
+		return;
+
+	std::vector<size_t> timestamps(numVertices, 0);
+	size_t time = cacheSize + 1;
+
+	auto countMisses = [&](size_t t)
+	{
+		int numMisses = 0;
+
+		for (int c = 0; c < 3; c++)
+		{
+			const uint16_t index = indices[t * 3 + c];
+
+			if (time - timestamps[index] > cacheSize)
+			{
+				timestamps[index] = time++;
+				numMisses++;
+			}
+		}
+
+		return numMisses;
+	};
+
+	std::vector<size_t> hardStarts;
+
+	for (size_t t = 0; t < numTris; t++)
+		if (countMisses(t) == 3 || !t)
+			hardStarts.push_back(t);
+
+	hardStarts.push_back(numTris);
+
+	std::vector<size_t> clusterStarts;
+
+	// Every cluster is simulated from an empty cache, that's what it gets after reordering.
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		const size_t begin = hardStarts[h];
+		const size_t end = hardStarts[h + 1];
+		size_t numMisses = 0;
+		time += cacheSize + 1;
+
+		for (size_t t = begin; t < end; t++)
+			numMisses += countMisses(t);
+
+		const float clusterThreshold = threshold * numMisses / (end - begin);
+		size_t clusterStart = begin;
+		numMisses = 0;
+		time += cacheSize + 1;
+		clusterStarts.push_back(begin);
+
+		for (size_t t = begin; t + 1 < end; t++)
+		{
+			numMisses += countMisses(t);
+
+			if (numMisses <= clusterThreshold * (t + 1 - clusterStart))
+			{
+				clusterStart = t + 1;
+				clusterStarts.push_back(clusterStart);
+				numMisses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	const size_t numClusters = clusterStarts.size();
+
+	if (numClusters < 2)
+		return;
+
+	clusterStarts.push_back(numTris);
+
+	// Area weighted centroid and normal of every cluster, cross product length is twice the area.
+	std::vector<float> clusterData(numClusters * 7, 0.0f);
+	float meshCenter[3] = {};
+	float meshArea = 0.0f;
+
+	for (size_t k = 0; k < numClusters; k++)
+	{
+		float *cluster = clusterData.data() + k * 7;
+
+		for (size_t t = clusterStarts[k]; t < clusterStarts[k + 1]; t++)
+		{
+			const float *p0 = xyz + indices[t * 3] * 3;
+			const float *p1 = xyz + indices[t * 3 + 1] * 3;
+			const float *p2 = xyz + indices[t * 3 + 2] * 3;
+			const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int a = 0; a < 3; a++)
+			{
+				cluster[a] += (p0[a] + p1[a] + p2[a]) * area;
+				cluster[3 + a] += normal[a];
+			}
+
+			cluster[6] += area;
+		}
+
+		for (int a = 0; a < 3; a++)
+			meshCenter[a] += cluster[a];
+
+		meshArea += cluster[6] * 3.0f;
+	}
+
+	if (meshArea > 0.0f)
+		for (int a = 0; a < 3; a++)
+			meshCenter[a] /= meshArea;
+
+	std::vector<std::pair<float, uint32_t>> sortKeys(numClusters);
+
+	for (size_t k = 0; k < numClusters; k++)
+	{
+		const float *cluster = clusterData.data() + k * 7;
+		const float area = cluster[6] * 3.0f;
+		const float normalLength = sqrtf(cluster[3] * cluster[3] + cluster[4] * cluster[4] + cluster[5] * cluster[5]);
+		float key = 0.0f;
+
+		if (area > 0.0f && normalLength > 0.0f)
+			for (int a = 0; a < 3; a++)
+				key += (cluster[a] / area - meshCenter[a]) * cluster[3 + a] / normalLength;
+
+		sortKeys[k] = std::make_pair(-key, static_cast<uint32_t>(k));
+	}
+
+	std::stable_sort(sortKeys.begin(), sortKeys.end(),
+		[](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) { return a.first < b.first; });
+
+	std::vector<uint16_t> output;
+	output.reserve(numTris * 3);
+
+	for (auto &k : sortKeys)
+		output.insert(output.end(), indices + clusterStarts[k.second] * 3, indices + clusterStarts[k.second + 1] * 3);
+
+	memcpy(indices, output.data(), output.size() * sizeof(uint16_t));
+}
+
+// Renumbers vertices in order of first use, outRemap receives new index of every old vertex.
+// Vertices without triangles keep their order after used ones, so vertex count doesn't change.
+inline void OptimizeVertexFetch(uint16_t *indices, size_t numIndices, size_t numVertices, uint32_t *outRemap)
+{
+	static const uint32_t unused = ~0u;
+	uint32_t next = 0;
+
+	for (size_t v = 0; v < numVertices; v++)
+		outRemap[v] = unused;
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		uint32_t &remap = outRemap[indices[i]];
+
+		if (remap == unused)
+			remap = next++;
+
+		indices[i] = static_cast<uint16_t>(remap);
+	}
+
+	for (size_t v = 0; v < numVertices; v++)
+		if (outRemap[v] == unused)
+			outRemap[v] = next++;
+}
+
+// Moves every elementSize wide element of a vertex stream to its remapped position.
+inline void RemapVertexStream(void *data, size_t elementSize, size_t numVertices, const uint32_t *remap)
+{
+	char *bytes = static_cast<char *>(data);
+	const std::vector<char> source(bytes, bytes + elementSize * numVertices);
+
+	for (size_t v = 0; v < numVertices; v++)
+		memcpy(bytes + remap[v] * elementSize, source.data() + v * elementSize, elementSize);
+}
@@ -0,0 +1,335 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "SyntheticModel.h"
+#include "ModelStaging.h"
+#include "ImportProfiler.h"
+#include "TaskScheduler.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+class SyntheticReader
+{
+	const char *data;
+	size_t size;
+	size_t offset;
+	bool failed;
+
+public:
+	SyntheticReader(const char *inData, size_t inSize) : data(inData), size(inSize), offset(0), failed(false) {}
+
+	// Returns section of numBytes, nullptr when out of bounds.
+	const char *Section(size_t numBytes)
+	{
+		offset = SyntheticAlign(offset);
+
+		if (failed || offset > size || numBytes > size - offset)
+		{
+			failed = true;
+			return nullptr;
+		}
+
+		const char *section = data + offset;
+		offset += numBytes;
+
+		return section;
+	}
+
+	template<class Type>
+	const Type *Read(size_t count = 1)
+	{
+		return reinterpret_cast<const Type *>(Section(sizeof(Type) * count));
+	}
+
+	bool Failed() const { return failed; }
+	size_t Remaining() const { return failed || offset > size ? 0 : size - offset; }
+};
+
+struct SyntheticMeshRecord
+{
+	const SyntheticMesh *header;
+	const SyntheticSubMesh *subMeshes;
+	const int32_t *remaps;
+	const float *positions;
+	const float *normals;
+	const float *uvs;
+	const uint8_t *boneIndices;
+	const float *boneWeights;
+	const uint16_t *indices;
+	uint32_t numIndices;
+};
+
+static bool ReadMesh(SyntheticReader &rd, SyntheticMeshRecord &record)
+{
+	const SyntheticMesh *hdr = rd.Read<SyntheticMesh>();
+
+	if (!hdr)
+		return false;
+
+	const size_t numVerts = hdr->numVertices;
+	const size_t numWeights = numVerts * hdr->numInfluences;
+
+	record.header = hdr;
+	record.subMeshes = rd.Read<SyntheticSubMesh>(hdr->numSubMeshes);
+	record.remaps = rd.Read<int32_t>(hdr->numRemaps);
+	record.positions = rd.Read<float>(numVerts * 3);
+	record.normals = rd.Read<float>(numVerts * 3);
+	record.uvs = rd.Read<float>(numVerts * 2);
+	record.boneIndices = rd.Read<uint8_t>(numWeights);
+	record.boneWeights = rd.Read<float>(numWeights);
+	record.numIndices = 0;
+
+	if (rd.Failed())
+		return false;
+
+	size_t numIndices = 0;
+
+	for (uint32_t s = 0; s < hdr->numSubMeshes; s++)
+	{
+		if (record.subMeshes[s].numIndices % 3)
+			return false;
+
+		numIndices += record.subMeshes[s].numIndices;
+	}
+
+	if (numIndices > rd.Remaining() / sizeof(uint16_t))
+		return false;
+
+	record.numIndices = static_cast<uint32_t>(numIndices);
+	record.indices = rd.Read<uint16_t>(record.numIndices);
+
+	if (rd.Failed())
+		return false;
+
+	// Staging, optimizer and scene build index vertex and remap tables with these unchecked.
+	for (uint32_t i = 0; i < record.numIndices; i++)
+		if (record.indices[i] >= numVerts)
+			return false;
+
+	if (hdr->numInfluences && hdr->numRemaps > 1)
+		for (size_t w = 0; w < numWeights; w++)
+			if (record.boneIndices[w] >= hdr->numRemaps)
+				return false;
+
+	return true;
+}
+
+static void DecodeSyntheticMesh(MeshStaging &staging, const SyntheticMeshRecord &record, const StagingSettings &settings)
+{
+	const SyntheticMesh &hdr = *record.header;
+	staging.name.assign(hdr.name, strnlen(hdr.name, SYNTHETIC_NAME_SIZE));
+
+	ScopedPhase phase(ImportPhase_Decode, staging.name.c_str());
+
+	const int numVerts = static_cast<int>(hdr.numVertices);
+	staging.numVertices = numVerts;
+	staging.numFaces = static_cast<int>(record.numIndices / 3);
+	staging.remaps.assign(record.remaps, record.remaps + hdr.numRemaps);
+
+	if (settings.headersOnly)
+	{
+		importProfiler.Add(ImportCounter_Meshes);
+		importProfiler.Add(ImportCounter_Vertices, numVerts);
+		return;
+	}
+
+	staging.positions.resize(numVerts);
+	memcpy(staging.positions.data(), record.positions, numVerts * sizeof(Vector));
+	ApexToMaxSpace(reinterpret_cast<float *>(staging.positions.data()), numVerts, settings.scale);
+
+	if (!StageBounds(staging, settings))
+		return;
+
+	staging.normals.resize(numVerts);
+	memcpy(staging.normals.data(), record.normals, numVerts * sizeof(Vector));
+	ApexToMaxSpace(reinterpret_cast<float *>(staging.normals.data()), numVerts, 1.0f);
+
+	staging.uvChannels.emplace_back(numVerts);
+	ExpandUVs(record.uvs, reinterpret_cast<float *>(staging.uvChannels.back().data()), numVerts, 1.0f, 1.0f);
+
+	staging.subMeshNameHashes.reserve(hdr.numSubMeshes);
+	staging.subMeshNumFaces.reserve(hdr.numSubMeshes);
+
+	for (uint32_t s = 0; s < hdr.numSubMeshes; s++)
+	{
+		staging.subMeshNameHashes.push_back(record.subMeshes[s].nameHash);
+		staging.subMeshNumFaces.push_back(record.subMeshes[s].numIndices / 3);
+	}
+
+	staging.faces.resize(staging.numFaces);
+	memcpy(staging.faces.data(), record.indices, staging.numFaces * sizeof(USVector));
+
+	if (hdr.numInfluences && hdr.numRemaps > 1)
+	{
+		SkinStaging &skin = staging.skin;
+		const size_t numWeights = static_cast<size_t>(numVerts) * hdr.numInfluences;
+
+		skin.numInfluences = hdr.numInfluences;
+		skin.indices.assign(record.boneIndices, record.boneIndices + numWeights);
+		skin.weights.assign(record.boneWeights, record.boneWeights + numWeights);
+	}
+
+	if (settings.optimizeMeshes)
+		OptimizeMesh(staging);
+
+	FingerprintMesh(staging);
+
+	importProfiler.Add(ImportCounter_Meshes);
+	importProfiler.Add(ImportCounter_Vertices, staging.numVertices);
+	importProfiler.Add(ImportCounter_Faces, staging.numFaces);
+}
+
+bool IsSyntheticModel(const char *data, size_t size)
+{
+	if (size < sizeof(SyntheticHeader))
+		return false;
+
+	SyntheticHeader hdr;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	return hdr.magic == SyntheticHeader::ID && hdr.version == SyntheticHeader::VERSION;
+}
+
+bool LoadSyntheticModel(const TCHAR *fileName, TrackedVector<char, MemoryCategory_ADF> &outData)
+{
+	FILE *fle = _tfopen(fileName, _T("rb"));
+
+	if (!fle)
+		return false;
+
+	SyntheticHeader hdr = {};
+	bool loaded = fread(&hdr, sizeof(hdr), 1, fle) == 1 && IsSyntheticModel(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+
+	if (loaded)
+	{
+		fseek(fle, 0, SEEK_END);
+		const long fileSize = ftell(fle);
+		fseek(fle, 0, SEEK_SET);
+
+		outData.resize(fileSize > 0 ? fileSize : 0);
+		loaded = fread(outData.data(), 1, outData.size(), fle) == outData.size();
+	}
+
+	fclose(fle);
+
+	return loaded;
+}
+
+bool StageSyntheticModel(ModelStaging &staging, const StagingSettings &settings)
+{
+	const char *data = staging.syntheticData.data();
+	const size_t size = staging.syntheticData.size();
+
+	if (!IsSyntheticModel(data, size))
+		return false;
+
+	SyntheticReader rd(data, size);
+	const SyntheticHeader *hdr = rd.Read<SyntheticHeader>();
+
+	if (hdr->numMaterials > size / sizeof(SyntheticMaterial) || hdr->numLODs > size / sizeof(SyntheticLOD))
+		return false;
+
+	staging.materials.resize(hdr->numMaterials);
+
+	for (auto &mat : staging.materials)
+	{
+		const SyntheticMaterial *smat = rd.Read<SyntheticMaterial>();
+
+		if (!smat)
+			return false;
+
+		mat.name.assign(smat->name, strnlen(smat->name, SYNTHETIC_NAME_SIZE));
+		mat.nameHash = smat->nameHash;
+		mat.pbr = smat->pbr != 0;
+
+		const char *textures = rd.Section(smat->numTextures * SYNTHETIC_NAME_SIZE);
+
+		if (rd.Failed())
+			return false;
+
+		mat.textures.reserve(smat->numTextures);
+
+		for (uint32_t t = 0; t < smat->numTextures; t++)
+		{
+			const char *texName = textures + t * SYNTHETIC_NAME_SIZE;
+			mat.textures.emplace_back(texName, strnlen(texName, SYNTHETIC_NAME_SIZE));
+		}
+	}
+
+	struct LODRecord
+	{
+		int lodIndex;
+		std::vector<SyntheticMeshRecord> meshes;
+	};
+
+	std::vector<LODRecord> lodRecords(hdr->numLODs);
+	int highestDetailLOD = INT_MAX;
+	int lowestDetailLOD = 0;
+
+	for (auto &lod : lodRecords)
+	{
+		const SyntheticLOD *slod = rd.Read<SyntheticLOD>();
+
+		if (!slod)
+			return false;
+
+		lod.lodIndex = static_cast<int>(slod->lodIndex);
+
+		if (slod->numMeshes > size / sizeof(SyntheticMesh))
+			return false;
+
+		lod.meshes.resize(slod->numMeshes);
+
+		for (auto &m : lod.meshes)
+			if (!ReadMesh(rd, m))
+				return false;
+
+		if (lod.lodIndex < highestDetailLOD)
+			highestDetailLOD = lod.lodIndex;
+
+		if (lod.lodIndex > lowestDetailLOD)
+			lowestDetailLOD = lod.lodIndex;
+	}
+
+	std::vector<std::pair<MeshStaging *, const SyntheticMeshRecord *>> meshes;
+	staging.lods.reserve(lodRecords.size());
+
+	for (auto &rlod : lodRecords)
+	{
+		if (!settings.lodFilter.Accepts(rlod.lodIndex, highestDetailLOD, lowestDetailLOD))
+			continue;
+
+		staging.lods.emplace_back();
+		LODStaging &lod = staging.lods.back();
+		lod.lodIndex = rlod.lodIndex;
+		lod.meshes.resize(rlod.meshes.size());
+
+		for (size_t m = 0; m < rlod.meshes.size(); m++)
+			meshes.emplace_back(&lod.meshes[m], &rlod.meshes[m]);
+	}
+
+	auto decodeTask = [&](size_t m) { DecodeSyntheticMesh(*meshes[m].first, *meshes[m].second, settings); };
+
+	if (taskScheduler)
+		taskScheduler->ParallelFor(meshes.size(), decodeTask);
+	else
+		for (size_t m = 0; m < meshes.size(); m++)
+			decodeTask(m);
+
+	return true;
+}
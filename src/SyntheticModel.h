@@ -0,0 +1,110 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ApexCompat.h"
+#include "ImportMemory.h"
+
+struct ModelStaging;
+struct StagingSettings;
+
+// Scale test container written by apexmax-synthgen.
+// Carries the geometry part of what a modelc/meshc pair stages into, geometry is in Apex space.
+// It is not an ADF or RBM file, it measures headless staging only, never 3ds Max import.
+// Every section starts on SYNTHETIC_ALIGNMENT boundary.
+//
+// SyntheticHeader
+// SyntheticMaterial[numMaterials]
+//	char textures[numTextures][SYNTHETIC_NAME_SIZE]
+// SyntheticLOD[numLODs]
+//	SyntheticMesh[numMeshes]
+//		SyntheticSubMesh[numSubMeshes]
+//		int32_t remaps[numRemaps]
+//		float positions[numVertices][3]
+//		float normals[numVertices][3]
+//		float uvs[numVertices][2]
+//		uint8_t boneIndices[numVertices][numInfluences]
+//		float boneWeights[numVertices][numInfluences]
+//		uint16_t indices[sum of SyntheticSubMesh::numIndices]
+
+static const size_t SYNTHETIC_NAME_SIZE = 64;
+static const size_t SYNTHETIC_ALIGNMENT = 8;
+
+inline size_t SyntheticAlign(size_t offset)
+{
+	return (offset + SYNTHETIC_ALIGNMENT - 1) & ~(SYNTHETIC_ALIGNMENT - 1);
+}
+
+struct SyntheticHeader
+{
+	static const uint32_t ID = 0x4E595341; // ASYN
+	static const uint32_t VERSION = 2;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numMaterials;
+	uint32_t numLODs;
+};
+
+struct SyntheticMaterial
+{
+	char name[SYNTHETIC_NAME_SIZE];
+	uint32_t nameHash;
+	uint32_t pbr;
+	uint32_t numTextures;
+};
+
+struct SyntheticLOD
+{
+	uint32_t lodIndex;
+	uint32_t numMeshes;
+};
+
+struct SyntheticMesh
+{
+	char name[SYNTHETIC_NAME_SIZE];
+	uint32_t numVertices;
+	uint32_t numSubMeshes;
+	uint32_t numRemaps;
+	uint32_t numInfluences;
+};
+
+struct SyntheticSubMesh
+{
+	uint32_t nameHash;
+	uint32_t numIndices;
+};
+
+// Test files are a dev only input, headless tools accept them when built with APEXMAX_SYNTHETIC_MODELS.
+// 3ds Max importer never does, other builds see every file as not synthetic.
+#ifdef APEXMAX_SYNTHETIC_MODELS
+bool IsSyntheticModel(const char *data, size_t size);
+
+// Reads whole file into outData, returns false when file is not a synthetic model.
+bool LoadSyntheticModel(const TCHAR *fileName, TrackedVector<char, MemoryCategory_ADF> &outData);
+
+// Expects staging.syntheticData, materials carry names and textures only, they have no attribute data.
+// Returns false for corrupted data, including indices out of vertex or remap range.
+bool StageSyntheticModel(ModelStaging &staging, const StagingSettings &settings);
+#else
+inline bool IsSyntheticModel(const char *, size_t) { return false; }
+inline bool LoadSyntheticModel(const TCHAR *, TrackedVector<char, MemoryCategory_ADF> &) { return false; }
+inline bool StageSyntheticModel(ModelStaging &, const StagingSettings &) { return false; }
+#endif
@@ -0,0 +1,189 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "TaskScheduler.h"
+#include "ImportArena.h"
+#include "ImportTrace.h"
+
+TaskScheduler *taskScheduler = nullptr;
+
+static const size_t noWorker = static_cast<size_t>(-1);
+static thread_local size_t currentWorker = noWorker;
+
+TaskScheduler::TaskScheduler(int numWorkers) : numPending(0), nextQueue(0), stopping(false)
+{
+	if (numWorkers <= 0)
+		numWorkers = static_cast<int>(std::thread::hardware_concurrency()) / 2;
+
+	if (numWorkers < 1)
+		numWorkers = 1;
+
+	queues.reserve(numWorkers);
+
+	for (int w = 0; w < numWorkers; w++)
+		queues.emplace_back(new WorkerQueue);
+
+	workers.reserve(numWorkers);
+
+	for (int w = 0; w < numWorkers; w++)
+		workers.emplace_back(&TaskScheduler::WorkerLoop, this, static_cast<size_t>(w));
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (auto &w : workers)
+		w.join();
+}
+
+void TaskScheduler::Push(Task task, TaskPriority priority)
+{
+	const size_t queueIndex = currentWorker != noWorker ? currentWorker : nextQueue++ % queues.size();
+
+	{
+		WorkerQueue &queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.tasks[priority].push_back(QueuedTask{std::move(task), ImportArena::Current()});
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		numPending++;
+	}
+
+	wake.notify_one();
+}
+
+bool TaskScheduler::Pop(size_t queueIndex, QueuedTask &outTask)
+{
+	WorkerQueue &queue = *queues[queueIndex];
+	std::lock_guard<std::mutex> guard(queue.lock);
+
+	for (auto &tasks : queue.tasks)
+		if (!tasks.empty())
+		{
+			outTask = std::move(tasks.back());
+			tasks.pop_back();
+			return true;
+		}
+
+	return false;
+}
+
+bool TaskScheduler::Steal(size_t thiefIndex, TaskPriority priority, QueuedTask &outTask)
+{
+	const size_t numQueues = queues.size();
+	const size_t startIndex = thiefIndex == noWorker ? 0 : thiefIndex + 1;
+
+	for (size_t q = 0; q < numQueues; q++)
+	{
+		const size_t victim = (startIndex + q) % numQueues;
+
+		if (victim == thiefIndex)
+			continue;
+
+		WorkerQueue &queue = *queues[victim];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		std::deque<QueuedTask> &tasks = queue.tasks[priority];
+
+		if (!tasks.empty())
+		{
+			outTask = std::move(tasks.front());
+			tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TaskScheduler::RunOne()
+{
+	QueuedTask task;
+	bool found = currentWorker != noWorker && Pop(currentWorker, task);
+
+	for (int p = 0; p < TaskPriority_Count && !found; p++)
+		found = Steal(currentWorker, static_cast<TaskPriority>(p), task);
+
+	if (!found)
+		return false;
+
+	numPending--;
+
+	ScopedArena arena(task.arena);
+	ScopedTrace trace("task");
+	task.task();
+
+	return true;
+}
+
+void TaskScheduler::WorkerLoop(size_t index)
+{
+	currentWorker = index;
+
+	while (true)
+	{
+		if (RunOne())
+			continue;
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [this]() { return stopping || numPending > 0; });
+
+		if (stopping)
+			break;
+	}
+}
+
+void TaskScheduler::ParallelFor(size_t count, const std::function<void(size_t)> &func, TaskPriority priority)
+{
+	if (!count)
+		return;
+
+	std::atomic<size_t> nextIndex(0);
+	std::atomic<size_t> numHelpers(0);
+
+	auto worker = [&]()
+	{
+		for (size_t i = nextIndex++; i < count; i = nextIndex++)
+			func(i);
+	};
+
+	const size_t maxHelpers = count - 1 < workers.size() ? count - 1 : workers.size();
+
+	for (size_t h = 0; h < maxHelpers; h++)
+	{
+		numHelpers++;
+		Push([&worker, &numHelpers]()
+		{
+			worker();
+			numHelpers--;
+		}, priority);
+	}
+
+	worker();
+
+	// Helpers reference this stack frame, wait until all of them are done.
+	while (numHelpers)
+		if (!RunOne())
+			std::this_thread::yield();
+}
@@ -0,0 +1,112 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ImportArena;
+
+enum TaskPriority
+{
+	TaskPriority_High,
+	TaskPriority_Normal,
+	TaskPriority_Low,
+	TaskPriority_Count
+};
+
+// Work stealing pool, every worker owns a deque per priority.
+// Workers pop their own newest task first and steal the oldest from others.
+// Tasks must not touch 3ds Max, scene work stays on the thread that waits for them.
+// Tasks run with the ImportArena that was bound to the pushing thread.
+class TaskScheduler
+{
+public:
+	typedef std::function<void()> Task;
+
+private:
+	struct QueuedTask
+	{
+		Task task;
+		ImportArena *arena;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex lock;
+		std::deque<QueuedTask> tasks[TaskPriority_Count];
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<long> numPending;
+	std::atomic<unsigned> nextQueue;
+	std::atomic<bool> stopping;
+
+	bool Pop(size_t queueIndex, QueuedTask &outTask);
+	bool Steal(size_t thiefIndex, TaskPriority priority, QueuedTask &outTask);
+	void WorkerLoop(size_t index);
+
+public:
+	// numWorkers <= 0 uses half of hardware threads.
+	explicit TaskScheduler(int numWorkers = 0);
+	~TaskScheduler();
+
+	void Push(Task task, TaskPriority priority = TaskPriority_Normal);
+
+	template<class Func>
+	auto Submit(Func &&func, TaskPriority priority = TaskPriority_Normal) -> std::future<decltype(func())>
+	{
+		typedef decltype(func()) ReturnType;
+		auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<Func>(func));
+		std::future<ReturnType> result = task->get_future();
+		Push([task]() { (*task)(); }, priority);
+
+		return result;
+	}
+
+	// Calls func for every index, calling thread takes part in the work.
+	void ParallelFor(size_t count, const std::function<void(size_t)> &func, TaskPriority priority = TaskPriority_Normal);
+
+	// Runs a single queued task on the calling thread, returns false when idle.
+	bool RunOne();
+
+	// Waits for a future while executing queued work.
+	template<class Type>
+	Type Wait(std::future<Type> &future)
+	{
+		while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			if (!RunOne())
+				future.wait_for(std::chrono::milliseconds(1));
+
+		return future.get();
+	}
+
+	int NumWorkers() const { return static_cast<int>(workers.size()); }
+};
+
+// Owned by the plugin, created in LibInitialize.
+extern TaskScheduler *taskScheduler;
@@ -0,0 +1,862 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Thumbnail.h"
+#include "TaskScheduler.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <zlib.h>
+
+static void RunParallel(size_t count, const std::function<void(size_t)> &func)
+{
+	if (taskScheduler)
+		taskScheduler->ParallelFor(count, func);
+	else
+		for (size_t i = 0; i < count; i++)
+			func(i);
+}
+
+static void WriteBE(uint8_t *dest, uint32_t value)
+{
+	dest[0] = static_cast<uint8_t>(value >> 24);
+	dest[1] = static_cast<uint8_t>(value >> 16);
+	dest[2] = static_cast<uint8_t>(value >> 8);
+	dest[3] = static_cast<uint8_t>(value);
+}
+
+static bool WritePNGChunk(FILE *fle, const char *type, const uint8_t *data, uint32_t size)
+{
+	uint8_t sizeBE[4], crcBE[4];
+	WriteBE(sizeBE, size);
+
+	uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+	crc = crc32(crc, data, size);
+	WriteBE(crcBE, static_cast<uint32_t>(crc));
+
+	return fwrite(sizeBE, 4, 1, fle) == 1 && fwrite(type, 4, 1, fle) == 1 && (!size || fwrite(data, size, 1, fle) == 1) &&
+		fwrite(crcBE, 4, 1, fle) == 1;
+}
+
+bool ThumbnailImage::SavePNG(const TCHAR *fileName) const
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	// Every row starts with filter type, none is used.
+	const size_t rowSize = width * 4;
+	std::vector<uint8_t> raw((rowSize + 1) * height);
+
+	for (int y = 0; y < height; y++)
+	{
+		raw[y * (rowSize + 1)] = 0;
+		memcpy(&raw[y * (rowSize + 1) + 1], &pixels[y * rowSize], rowSize);
+	}
+
+	uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+	std::vector<uint8_t> compressed(compressedSize);
+
+	if (compress2(compressed.data(), &compressedSize, raw.data(), static_cast<uLong>(raw.size()), 6) != Z_OK)
+		return false;
+
+	FILE *fle = _tfopen(fileName, _T("wb"));
+
+	if (!fle)
+		return false;
+
+	static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	uint8_t header[13];
+	WriteBE(header, width);
+	WriteBE(header + 4, height);
+	header[8] = 8;  // bit depth
+	header[9] = 6;  // rgba
+	header[10] = 0; // deflate
+	header[11] = 0; // adaptive filtering
+	header[12] = 0; // no interlace
+
+	const bool written = fwrite(signature, sizeof(signature), 1, fle) == 1 && WritePNGChunk(fle, "IHDR", header, sizeof(header)) &&
+		WritePNGChunk(fle, "IDAT", compressed.data(), static_cast<uint32_t>(compressedSize)) && WritePNGChunk(fle, "IEND", nullptr, 0);
+	fclose(fle);
+
+	return written;
+}
+
+struct DDSPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rMask;
+	uint32_t gMask;
+	uint32_t bMask;
+	uint32_t aMask;
+};
+
+struct DDSHeader
+{
+	static const uint32_t ID = 0x20534444; // "DDS "
+
+	uint32_t magic;
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat format;
+	uint32_t caps[4];
+	uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 128 && sizeof(DDSHeaderDX10) == 20, "Invalid DDS header layout");
+
+enum TextureFormat
+{
+	TextureFormat_Unknown,
+	TextureFormat_BC1,
+	TextureFormat_BC2,
+	TextureFormat_BC3,
+	TextureFormat_Masked32
+};
+
+// D3D11 texture limit, larger headers are broken files and would overflow int sizes.
+static const uint32_t maxTextureSize = 16384;
+
+static constexpr uint32_t FourCC(char c0, char c1, char c2, char c3)
+{
+	return static_cast<uint32_t>(c0) | static_cast<uint32_t>(c1) << 8 | static_cast<uint32_t>(c2) << 16 | static_cast<uint32_t>(c3) << 24;
+}
+
+static void Unpack565(uint16_t color, uint8_t *rgba)
+{
+	const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+	rgba[0] = static_cast<uint8_t>(r << 3 | r >> 2);
+	rgba[1] = static_cast<uint8_t>(g << 2 | g >> 4);
+	rgba[2] = static_cast<uint8_t>(b << 3 | b >> 2);
+	rgba[3] = 255;
+}
+
+// 4x4 rgba texels from BC1 color part, alpha of BC2 and BC3 is decoded separately.
+static void DecodeColorBlock(const uint8_t *block, uint8_t *texels, bool alwaysFourColors)
+{
+	const uint16_t c0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+	const uint16_t c1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+	uint8_t palette[4][4];
+	Unpack565(c0, palette[0]);
+	Unpack565(c1, palette[1]);
+
+	for (int c = 0; c < 3; c++)
+	{
+		if (c0 > c1 || alwaysFourColors)
+		{
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+		else
+		{
+			palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+	}
+
+	palette[2][3] = 255;
+	palette[3][3] = c0 > c1 || alwaysFourColors ? 255 : 0;
+
+	const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+
+	for (int t = 0; t < 16; t++)
+		memcpy(texels + t * 4, palette[(indices >> (t * 2)) & 3], 4);
+}
+
+static void DecodeBC2Alpha(const uint8_t *block, uint8_t *texels)
+{
+	for (int t = 0; t < 16; t++)
+		texels[t * 4 + 3] = static_cast<uint8_t>(((block[t / 2] >> ((t & 1) * 4)) & 15) * 17);
+}
+
+static void DecodeBC3Alpha(const uint8_t *block, uint8_t *texels)
+{
+	const int a0 = block[0], a1 = block[1];
+	int palette[8] = { a0, a1 };
+
+	if (a0 > a1)
+		for (int a = 1; a < 7; a++)
+			palette[a + 1] = ((7 - a) * a0 + a * a1) / 7;
+	else
+	{
+		for (int a = 1; a < 5; a++)
+			palette[a + 1] = ((5 - a) * a0 + a * a1) / 5;
+
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+
+	for (int b = 0; b < 6; b++)
+		indices |= static_cast<uint64_t>(block[2 + b]) << (b * 8);
+
+	for (int t = 0; t < 16; t++)
+		texels[t * 4 + 3] = static_cast<uint8_t>(palette[(indices >> (t * 3)) & 7]);
+}
+
+static uint8_t MaskedChannel(uint32_t value, uint32_t mask)
+{
+	if (!mask)
+		return 255;
+
+	int shift = 0;
+
+	while (!((mask >> shift) & 1))
+		shift++;
+
+	const uint32_t maxValue = mask >> shift;
+
+	return static_cast<uint8_t>(((value & mask) >> shift) * 255 / maxValue);
+}
+
+bool ThumbnailTexture::Decode(const char *data, size_t size, int maxSize)
+{
+	if (size < sizeof(DDSHeader))
+		return false;
+
+	const DDSHeader *hdr = reinterpret_cast<const DDSHeader *>(data);
+
+	if (hdr->magic != DDSHeader::ID || !hdr->width || !hdr->height || hdr->width > maxTextureSize || hdr->height > maxTextureSize)
+		return false;
+
+	size_t offset = sizeof(DDSHeader);
+	TextureFormat format = TextureFormat_Unknown;
+	DDSPixelFormat masks = hdr->format;
+	const uint32_t fourCC = hdr->format.flags & 4 ? hdr->format.fourCC : 0;
+
+	if (fourCC == FourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + sizeof(DDSHeaderDX10))
+			return false;
+
+		const DDSHeaderDX10 *dx10 = reinterpret_cast<const DDSHeaderDX10 *>(data + offset);
+		offset += sizeof(DDSHeaderDX10);
+
+		switch (dx10->dxgiFormat)
+		{
+		case 71: case 72:
+			format = TextureFormat_BC1;
+			break;
+		case 74: case 75:
+			format = TextureFormat_BC2;
+			break;
+		case 77: case 78:
+			format = TextureFormat_BC3;
+			break;
+		case 28: case 29:
+			format = TextureFormat_Masked32;
+			masks.rMask = 0xFF;
+			masks.gMask = 0xFF00;
+			masks.bMask = 0xFF0000;
+			masks.aMask = 0xFF000000;
+			break;
+		case 87: case 91:
+			format = TextureFormat_Masked32;
+			masks.rMask = 0xFF0000;
+			masks.gMask = 0xFF00;
+			masks.bMask = 0xFF;
+			masks.aMask = 0xFF000000;
+			break;
+		default:
+			break;
+		}
+	}
+	else if (fourCC == FourCC('D', 'X', 'T', '1'))
+		format = TextureFormat_BC1;
+	else if (fourCC == FourCC('D', 'X', 'T', '2') || fourCC == FourCC('D', 'X', 'T', '3'))
+		format = TextureFormat_BC2;
+	else if (fourCC == FourCC('D', 'X', 'T', '4') || fourCC == FourCC('D', 'X', 'T', '5'))
+		format = TextureFormat_BC3;
+	else if (!fourCC && hdr->format.rgbBitCount == 32)
+		format = TextureFormat_Masked32;
+
+	if (format == TextureFormat_Unknown)
+		return false;
+
+	const bool compressed = format != TextureFormat_Masked32;
+	const size_t blockSize = format == TextureFormat_BC1 ? 8 : 16;
+	const int numMips = hdr->mipMapCount > 1 ? static_cast<int>(hdr->mipMapCount) : 1;
+	int levelWidth = hdr->width, levelHeight = hdr->height;
+	size_t levelSize = 0;
+
+	// Skip mips larger than needed, thumbnails never sample them.
+	for (int m = 0; ; m++)
+	{
+		const size_t blocksX = (levelWidth + 3) / 4, blocksY = (levelHeight + 3) / 4;
+		levelSize = compressed ? blocksX * blocksY * blockSize : static_cast<size_t>(levelWidth) * levelHeight * 4;
+
+		if (m + 1 == numMips || (levelWidth <= maxSize && levelHeight <= maxSize))
+			break;
+
+		offset += levelSize;
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+
+	if (offset + levelSize > size)
+		return false;
+
+	width = levelWidth;
+	height = levelHeight;
+	pixels.resize(static_cast<size_t>(width) * height * 4);
+
+	const uint8_t *src = reinterpret_cast<const uint8_t *>(data + offset);
+
+	if (!compressed)
+	{
+		for (size_t t = 0; t < static_cast<size_t>(width) * height; t++, src += 4)
+		{
+			const uint32_t value = src[0] | src[1] << 8 | src[2] << 16 | static_cast<uint32_t>(src[3]) << 24;
+			pixels[t * 4] = MaskedChannel(value, masks.rMask);
+			pixels[t * 4 + 1] = MaskedChannel(value, masks.gMask);
+			pixels[t * 4 + 2] = MaskedChannel(value, masks.bMask);
+			pixels[t * 4 + 3] = MaskedChannel(value, masks.aMask);
+		}
+
+		return true;
+	}
+
+	const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+
+	for (int by = 0; by < blocksY; by++)
+		for (int bx = 0; bx < blocksX; bx++, src += blockSize)
+		{
+			uint8_t texels[64];
+
+			if (format == TextureFormat_BC1)
+				DecodeColorBlock(src, texels, false);
+			else
+			{
+				DecodeColorBlock(src + 8, texels, true);
+
+				if (format == TextureFormat_BC2)
+					DecodeBC2Alpha(src, texels);
+				else
+					DecodeBC3Alpha(src, texels);
+			}
+
+			for (int ty = 0; ty < 4 && by * 4 + ty < height; ty++)
+				for (int tx = 0; tx < 4 && bx * 4 + tx < width; tx++)
+					memcpy(&pixels[((by * 4 + ty) * width + bx * 4 + tx) * 4], texels + (ty * 4 + tx) * 4, 4);
+		}
+
+	return true;
+}
+
+bool ThumbnailTexture::Load(const TCHAR *fileName, int maxSize)
+{
+	MappedFile file;
+
+	return file.Open(fileName) && Decode(file.Data(), file.Size(), maxSize);
+}
+
+static int Wrap(int value, int size)
+{
+	value %= size;
+
+	return value < 0 ? value + size : value;
+}
+
+void ThumbnailTexture::Sample(float u, float v, float *outColor) const
+{
+	const float x = u * width - 0.5f, y = (1.0f - v) * height - 0.5f;
+	const float fx = floorf(x), fy = floorf(y);
+	const float wx = x - fx, wy = y - fy;
+	const int x0 = Wrap(static_cast<int>(fx), width), x1 = Wrap(x0 + 1, width);
+	const int y0 = Wrap(static_cast<int>(fy), height), y1 = Wrap(y0 + 1, height);
+	const uint8_t *t00 = &pixels[(y0 * width + x0) * 4], *t10 = &pixels[(y0 * width + x1) * 4],
+		*t01 = &pixels[(y1 * width + x0) * 4], *t11 = &pixels[(y1 * width + x1) * 4];
+
+	for (int c = 0; c < 3; c++)
+	{
+		const float top = t00[c] + (t10[c] - t00[c]) * wx;
+		const float bottom = t01[c] + (t11[c] - t01[c]) * wx;
+		outColor[c] = (top + (bottom - top) * wy) * (1.0f / 255.0f);
+	}
+}
+
+const ThumbnailTexture *ThumbnailTextureCache::Get(const std::string &path)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto found = textures.find(path);
+
+		if (found != textures.end())
+			return found->second.get();
+	}
+
+	// Decoded outside of lock, racing threads may decode the same texture, first one is kept.
+	const TSTRING fullPath = rootFolder + _T("/") + static_cast<TSTRING>(esString(path));
+	std::unique_ptr<ThumbnailTexture> texture(new ThumbnailTexture());
+	bool loaded = texture->Load(fullPath.c_str(), maxSize);
+
+	if (!loaded && fullPath.size() > 5 && !_tcsicmp(fullPath.c_str() + fullPath.size() - 5, _T(".ddsc")))
+		loaded = texture->Load(fullPath.substr(0, fullPath.size() - 1).c_str(), maxSize);
+
+	if (!loaded)
+		texture.reset();
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	return textures.emplace(path, std::move(texture)).first->second.get();
+}
+
+static const int tileSize = 32;
+static const size_t binChunkSize = 0x4000;
+
+struct RasterVertex
+{
+	float position[3]; // pixels, depth grows towards camera
+	float normal[3];   // view space
+	float uv[2];
+	bool hasNormal;
+};
+
+struct RasterTriangle
+{
+	uint32_t vertices[3];
+	int texture;
+};
+
+struct RasterMesh
+{
+	const MeshStaging *mesh;
+	size_t firstVertex;
+	size_t firstTriangle;
+	std::vector<int> subMeshTextures;
+};
+
+static float Dot(const float *v0, const float *v1)
+{
+	return v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2];
+}
+
+static void Normalize(float *v)
+{
+	const float length = sqrtf(Dot(v, v));
+
+	if (length > 0.0f)
+		for (int c = 0; c < 3; c++)
+			v[c] /= length;
+}
+
+static float Edge(const float *v0, const float *v1, float px, float py)
+{
+	return (v1[0] - v0[0]) * (py - v0[1]) - (v1[1] - v0[1]) * (px - v0[0]);
+}
+
+class ThumbnailRaster
+{
+	const ThumbnailSettings &settings;
+	const std::vector<RasterVertex> &vertices;
+	const std::vector<RasterTriangle> &triangles;
+	const std::vector<const ThumbnailTexture *> &textures;
+	float light[3];
+
+public:
+	int size;
+	int tilesX;
+	std::vector<std::vector<uint32_t>> bins; // per chunk, per tile
+	std::vector<uint8_t> pixels;
+
+	ThumbnailRaster(const ThumbnailSettings &settings, const std::vector<RasterVertex> &vertices,
+		const std::vector<RasterTriangle> &triangles, const std::vector<const ThumbnailTexture *> &textures, int size) :
+		settings(settings), vertices(vertices), triangles(triangles), textures(textures), size(size), tilesX((size + tileSize - 1) / tileSize),
+		pixels(static_cast<size_t>(size) * size * 4)
+	{
+		light[0] = -0.35f;
+		light[1] = 0.55f;
+		light[2] = 0.75f;
+		Normalize(light);
+	}
+
+	size_t NumTiles() const { return static_cast<size_t>(tilesX) * tilesX; }
+
+	void Bin(size_t chunk)
+	{
+		std::vector<uint32_t> *chunkBins = &bins[chunk * NumTiles()];
+		const size_t lastTriangle = (chunk + 1) * binChunkSize < triangles.size() ? (chunk + 1) * binChunkSize : triangles.size();
+
+		for (size_t t = chunk * binChunkSize; t < lastTriangle; t++)
+		{
+			const float *p0 = vertices[triangles[t].vertices[0]].position, *p1 = vertices[triangles[t].vertices[1]].position,
+				*p2 = vertices[triangles[t].vertices[2]].position;
+
+			if (Edge(p0, p1, p2[0], p2[1]) == 0.0f)
+				continue;
+
+			const float minX = fminf(p0[0], fminf(p1[0], p2[0])), maxX = fmaxf(p0[0], fmaxf(p1[0], p2[0]));
+			const float minY = fminf(p0[1], fminf(p1[1], p2[1])), maxY = fmaxf(p0[1], fmaxf(p1[1], p2[1]));
+
+			if (maxX < 0.0f || maxY < 0.0f || minX >= size || minY >= size)
+				continue;
+
+			const int tx0 = minX > 0.0f ? static_cast<int>(minX) / tileSize : 0;
+			const int ty0 = minY > 0.0f ? static_cast<int>(minY) / tileSize : 0;
+			const int tx1 = maxX < size - 1 ? static_cast<int>(maxX) / tileSize : tilesX - 1;
+			const int ty1 = maxY < size - 1 ? static_cast<int>(maxY) / tileSize : tilesX - 1;
+
+			for (int ty = ty0; ty <= ty1; ty++)
+				for (int tx = tx0; tx <= tx1; tx++)
+					chunkBins[ty * tilesX + tx].push_back(static_cast<uint32_t>(t));
+		}
+	}
+
+	void Shade(const RasterTriangle &tri, const float *bary, const float *faceNormal, uint8_t *outPixel) const
+	{
+		float normal[3];
+
+		if (settings.shading == ThumbnailShading_Flat || !vertices[tri.vertices[0]].hasNormal)
+			memcpy(normal, faceNormal, sizeof(normal));
+		else
+		{
+			for (int c = 0; c < 3; c++)
+				normal[c] = vertices[tri.vertices[0]].normal[c] * bary[0] + vertices[tri.vertices[1]].normal[c] * bary[1] +
+					vertices[tri.vertices[2]].normal[c] * bary[2];
+
+			Normalize(normal);
+
+			// Back faces are lit as front faces.
+			if (normal[2] < 0.0f)
+				for (int c = 0; c < 3; c++)
+					normal[c] = -normal[c];
+		}
+
+		float color[3] = { 0.72f, 0.72f, 0.72f };
+
+		if (settings.shading == ThumbnailShading_Normals)
+			for (int c = 0; c < 3; c++)
+				color[c] = normal[c] * 0.5f + 0.5f;
+		else
+		{
+			if (tri.texture >= 0)
+			{
+				float uv[2];
+
+				for (int c = 0; c < 2; c++)
+					uv[c] = vertices[tri.vertices[0]].uv[c] * bary[0] + vertices[tri.vertices[1]].uv[c] * bary[1] +
+						vertices[tri.vertices[2]].uv[c] * bary[2];
+
+				textures[tri.texture]->Sample(uv[0], uv[1], color);
+			}
+
+			const float diffuse = Dot(normal, light);
+			const float lighting = 0.3f + 0.7f * (diffuse > 0.0f ? diffuse : 0.0f);
+
+			for (int c = 0; c < 3; c++)
+				color[c] *= lighting;
+		}
+
+		for (int c = 0; c < 3; c++)
+			outPixel[c] = static_cast<uint8_t>(color[c] >= 1.0f ? 255 : color[c] * 255.0f + 0.5f);
+
+		outPixel[3] = 255;
+	}
+
+	void Rasterize(size_t tile)
+	{
+		const int tileX = static_cast<int>(tile % tilesX) * tileSize, tileY = static_cast<int>(tile / tilesX) * tileSize;
+		const int tileEndX = tileX + tileSize < size ? tileX + tileSize : size, tileEndY = tileY + tileSize < size ? tileY + tileSize : size;
+		float depth[tileSize * tileSize];
+
+		for (float &d : depth)
+			d = -FLT_MAX;
+
+		// Chunks go in triangle order, equal depths resolve the same way every time.
+		for (size_t b = tile; b < bins.size(); b += NumTiles())
+			for (uint32_t t : bins[b])
+			{
+				const RasterTriangle &tri = triangles[t];
+				const float *p0 = vertices[tri.vertices[0]].position;
+				const float *p1 = vertices[tri.vertices[1]].position;
+				const float *p2 = vertices[tri.vertices[2]].position;
+				const float area = Edge(p0, p1, p2[0], p2[1]);
+				const float sign = area > 0.0f ? 1.0f : -1.0f;
+				const float invArea = 1.0f / (area * sign);
+
+				// Screen y points down, flip it back for a view space face normal.
+				const float e0[] = { p1[0] - p0[0], p0[1] - p1[1], p1[2] - p0[2] };
+				const float e1[] = { p2[0] - p0[0], p0[1] - p2[1], p2[2] - p0[2] };
+				float faceNormal[] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+				Normalize(faceNormal);
+
+				if (faceNormal[2] < 0.0f)
+					for (int c = 0; c < 3; c++)
+						faceNormal[c] = -faceNormal[c];
+
+				const float minX = fminf(p0[0], fminf(p1[0], p2[0])), maxX = fmaxf(p0[0], fmaxf(p1[0], p2[0]));
+				const float minY = fminf(p0[1], fminf(p1[1], p2[1])), maxY = fmaxf(p0[1], fmaxf(p1[1], p2[1]));
+				const int x0 = minX > tileX ? static_cast<int>(minX) : tileX;
+				const int y0 = minY > tileY ? static_cast<int>(minY) : tileY;
+				const int x1 = maxX + 1.0f < tileEndX ? static_cast<int>(maxX) + 1 : tileEndX;
+				const int y1 = maxY + 1.0f < tileEndY ? static_cast<int>(maxY) + 1 : tileEndY;
+
+				for (int y = y0; y < y1; y++)
+				{
+					const float py = y + 0.5f;
+					float w0 = Edge(p1, p2, x0 + 0.5f, py) * sign;
+					float w1 = Edge(p2, p0, x0 + 0.5f, py) * sign;
+					float w2 = Edge(p0, p1, x0 + 0.5f, py) * sign;
+					const float step0 = (p1[1] - p2[1]) * sign, step1 = (p2[1] - p0[1]) * sign, step2 = (p0[1] - p1[1]) * sign;
+
+					for (int x = x0; x < x1; x++, w0 += step0, w1 += step1, w2 += step2)
+					{
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+							continue;
+
+						const float bary[] = { w0 * invArea, w1 * invArea, w2 * invArea };
+						const float z = p0[2] * bary[0] + p1[2] * bary[1] + p2[2] * bary[2];
+						float &tileDepth = depth[(y - tileY) * tileSize + x - tileX];
+
+						if (z <= tileDepth)
+							continue;
+
+						tileDepth = z;
+						Shade(tri, bary, faceNormal, &pixels[(static_cast<size_t>(y) * size + x) * 4]);
+					}
+				}
+			}
+	}
+};
+
+bool RenderThumbnail(const ModelStaging &staging, const ThumbnailSettings &settings, ThumbnailTextureCache *textures,
+	ThumbnailImage &outImage)
+{
+	const LODStaging *lod = nullptr;
+
+	for (auto &l : staging.lods)
+		if (!lod || l.lodIndex < lod->lodIndex)
+			lod = &l;
+
+	if (!lod)
+		return false;
+
+	std::vector<RasterMesh> meshes;
+	std::vector<const ThumbnailTexture *> usedTextures;
+	std::unordered_map<const ThumbnailTexture *, int> textureIndices;
+	size_t numVertices = 0, numTriangles = 0;
+
+	for (auto &mesh : lod->meshes)
+	{
+		if (!mesh.Valid() || mesh.culled || mesh.positions.size() != static_cast<size_t>(mesh.numVertices) || mesh.faces.empty())
+			continue;
+
+		RasterMesh rmesh;
+		rmesh.mesh = &mesh;
+		rmesh.firstVertex = numVertices;
+		rmesh.firstTriangle = numTriangles;
+
+		for (ApexHash hash : mesh.subMeshNameHashes)
+		{
+			const ThumbnailTexture *texture = nullptr;
+
+			if (textures && settings.textured && !mesh.uvChannels.empty())
+				for (auto &mat : staging.materials)
+					if (mat.nameHash == hash && mat.textures.size() && !mat.textures[0].empty())
+					{
+						texture = textures->Get(mat.textures[0].c_str());
+						break;
+					}
+
+			int textureIndex = -1;
+
+			if (texture)
+			{
+				auto found = textureIndices.find(texture);
+
+				if (found == textureIndices.end())
+				{
+					found = textureIndices.emplace(texture, static_cast<int>(usedTextures.size())).first;
+					usedTextures.push_back(texture);
+				}
+
+				textureIndex = found->second;
+			}
+
+			rmesh.subMeshTextures.push_back(textureIndex);
+		}
+
+		numVertices += mesh.numVertices;
+		numTriangles += mesh.faces.size();
+		meshes.push_back(std::move(rmesh));
+	}
+
+	if (!numTriangles)
+		return false;
+
+	const float degToRad = 3.14159265f / 180.0f;
+	const float pitch = (settings.pitch > 89.0f ? 89.0f : (settings.pitch < -89.0f ? -89.0f : settings.pitch)) * degToRad;
+	const float yaw = settings.yaw * degToRad;
+
+	// Orthographic view, Max Z up, eye points from model towards camera.
+	float eye[] = { cosf(pitch) * sinf(yaw), -cosf(pitch) * cosf(yaw), sinf(pitch) };
+	float right[] = { -eye[1], eye[0], 0.0f };
+	Normalize(right);
+	const float up[] = { eye[1] * right[2] - eye[2] * right[1], eye[2] * right[0] - eye[0] * right[2], eye[0] * right[1] - eye[1] * right[0] };
+	const float *axes[] = { right, up, eye };
+
+	std::vector<RasterVertex> vertices(numVertices);
+	std::vector<float> meshExtents(meshes.size() * 4);
+
+	RunParallel(meshes.size(), [&](size_t m)
+	{
+		const MeshStaging &mesh = *meshes[m].mesh;
+		const bool hasNormals = mesh.normals.size() == mesh.positions.size();
+		const bool hasUVs = !mesh.uvChannels.empty() && mesh.uvChannels[0].size() == mesh.positions.size();
+		float *extents = &meshExtents[m * 4];
+		extents[0] = extents[1] = FLT_MAX;
+		extents[2] = extents[3] = -FLT_MAX;
+
+		for (int v = 0; v < mesh.numVertices; v++)
+		{
+			RasterVertex &vert = vertices[meshes[m].firstVertex + v];
+			const float *position = &mesh.positions[v].X;
+
+			for (int a = 0; a < 3; a++)
+			{
+				vert.position[a] = Dot(position, axes[a]);
+				vert.normal[a] = hasNormals ? Dot(&mesh.normals[v].X, axes[a]) : 0.0f;
+			}
+
+			vert.hasNormal = hasNormals;
+			vert.uv[0] = hasUVs ? mesh.uvChannels[0][v].X : 0.0f;
+			vert.uv[1] = hasUVs ? mesh.uvChannels[0][v].Y : 0.0f;
+
+			extents[0] = fminf(extents[0], vert.position[0]);
+			extents[1] = fminf(extents[1], vert.position[1]);
+			extents[2] = fmaxf(extents[2], vert.position[0]);
+			extents[3] = fmaxf(extents[3], vert.position[1]);
+		}
+	});
+
+	float extents[] = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (size_t m = 0; m < meshes.size(); m++)
+		for (int e = 0; e < 4; e++)
+			extents[e] = e < 2 ? fminf(extents[e], meshExtents[m * 4 + e]) : fmaxf(extents[e], meshExtents[m * 4 + e]);
+
+	const int supersample = settings.supersample < 1 ? 1 : (settings.supersample > 4 ? 4 : settings.supersample);
+	const int outSize = settings.size < 8 ? 8 : settings.size;
+	const int rasterSize = outSize * supersample;
+	const float width = extents[2] - extents[0], height = extents[3] - extents[1];
+	const float viewSize = (width > height ? width : height) * 1.1f;
+	const float pixelScale = viewSize > 0.0f ? rasterSize / viewSize : 1.0f;
+	const float centerX = (extents[0] + extents[2]) * 0.5f, centerY = (extents[1] + extents[3]) * 0.5f;
+	std::vector<RasterTriangle> triangles(numTriangles);
+
+	RunParallel(meshes.size(), [&](size_t m)
+	{
+		const RasterMesh &rmesh = meshes[m];
+		const MeshStaging &mesh = *rmesh.mesh;
+
+		for (int v = 0; v < mesh.numVertices; v++)
+		{
+			RasterVertex &vert = vertices[rmesh.firstVertex + v];
+			vert.position[0] = (vert.position[0] - centerX) * pixelScale + rasterSize * 0.5f;
+			vert.position[1] = rasterSize * 0.5f - (vert.position[1] - centerY) * pixelScale;
+			vert.position[2] *= pixelScale;
+		}
+
+		size_t currentFace = 0;
+
+		for (size_t s = 0; s < mesh.subMeshNumFaces.size(); s++)
+			for (int f = 0; f < mesh.subMeshNumFaces[s] && currentFace < mesh.faces.size(); f++, currentFace++)
+			{
+				RasterTriangle &tri = triangles[rmesh.firstTriangle + currentFace];
+				const USVector &face = mesh.faces[currentFace];
+				tri.vertices[0] = static_cast<uint32_t>(rmesh.firstVertex + face.X);
+				tri.vertices[1] = static_cast<uint32_t>(rmesh.firstVertex + face.Y);
+				tri.vertices[2] = static_cast<uint32_t>(rmesh.firstVertex + face.Z);
+				tri.texture = s < rmesh.subMeshTextures.size() ? rmesh.subMeshTextures[s] : -1;
+			}
+
+		// Faces without a submesh still get drawn, they would reference vertex 0 otherwise.
+		for (; currentFace < mesh.faces.size(); currentFace++)
+		{
+			RasterTriangle &tri = triangles[rmesh.firstTriangle + currentFace];
+			const USVector &face = mesh.faces[currentFace];
+			tri.vertices[0] = static_cast<uint32_t>(rmesh.firstVertex + face.X);
+			tri.vertices[1] = static_cast<uint32_t>(rmesh.firstVertex + face.Y);
+			tri.vertices[2] = static_cast<uint32_t>(rmesh.firstVertex + face.Z);
+			tri.texture = -1;
+		}
+	});
+
+	ThumbnailRaster raster(settings, vertices, triangles, usedTextures, rasterSize);
+	const size_t numChunks = (numTriangles + binChunkSize - 1) / binChunkSize;
+	raster.bins.resize(numChunks * raster.NumTiles());
+
+	RunParallel(numChunks, [&](size_t c) { raster.Bin(c); });
+	RunParallel(raster.NumTiles(), [&](size_t t) { raster.Rasterize(t); });
+
+	// Box filter down to output size, color is averaged over covered samples only.
+	outImage.width = outSize;
+	outImage.height = outSize;
+	outImage.pixels.resize(static_cast<size_t>(outSize) * outSize * 4);
+
+	RunParallel(outSize, [&](size_t y)
+	{
+		for (int x = 0; x < outSize; x++)
+		{
+			int sum[3] = {}, numCovered = 0;
+
+			for (int sy = 0; sy < supersample; sy++)
+				for (int sx = 0; sx < supersample; sx++)
+				{
+					const uint8_t *sample = &raster.pixels[((y * supersample + sy) * rasterSize + x * supersample + sx) * 4];
+
+					if (!sample[3])
+						continue;
+
+					for (int c = 0; c < 3; c++)
+						sum[c] += sample[c];
+
+					numCovered++;
+				}
+
+			uint8_t *pixel = &outImage.pixels[(y * outSize + x) * 4];
+
+			for (int c = 0; c < 3; c++)
+				pixel[c] = static_cast<uint8_t>(numCovered ? sum[c] / numCovered : 0);
+
+			pixel[3] = static_cast<uint8_t>(numCovered * 255 / (supersample * supersample));
+		}
+	});
+
+	return true;
+}
@@ -0,0 +1,100 @@
+/*  Apex Tool for 3ds Max
+	Copyright(C) 2014-2019 Lukas Cone
+
+	This program is free software : you can redistribute it and / or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ModelStaging.h"
+#include "datas/esstring.h"
+
+enum ThumbnailShading
+{
+	ThumbnailShading_Flat,
+	ThumbnailShading_Smooth,
+	ThumbnailShading_Normals // view space normals as colors
+};
+
+// Camera orbits Max Z axis, yaw 0 and pitch 0 is the front view.
+struct ThumbnailSettings
+{
+	int size;
+	int supersample;
+	ThumbnailShading shading;
+	float yaw;
+	float pitch;
+	bool textured;
+
+	ThumbnailSettings() : size(256), supersample(2), shading(ThumbnailShading_Flat), yaw(-35.0f), pitch(25.0f), textured(false) {}
+};
+
+// Straight rgba rows, top to bottom.
+struct ThumbnailImage
+{
+	int width;
+	int height;
+	std::vector<uint8_t> pixels;
+
+	ThumbnailImage() : width(0), height(0) {}
+	bool SavePNG(const TCHAR *fileName) const;
+};
+
+// Decoded DDS, only the first mip level not larger than maxSize is kept.
+// Supports BC1, BC2, BC3 and 32 bit uncompressed data.
+class ThumbnailTexture
+{
+	int width;
+	int height;
+	std::vector<uint8_t> pixels;
+
+public:
+	ThumbnailTexture() : width(0), height(0) {}
+
+	bool Load(const TCHAR *fileName, int maxSize);
+	bool Decode(const char *data, size_t size, int maxSize);
+
+	// Bilinear, wraps around, uv is in Max convention.
+	void Sample(float u, float v, float *outColor) const;
+};
+
+// Diffuse textures shared between models, paths are resolved under root folder.
+// Apex .ddsc paths fall back to .dds files next to them.
+class ThumbnailTextureCache
+{
+	TSTRING rootFolder;
+	std::mutex lock;
+	std::unordered_map<std::string, std::unique_ptr<ThumbnailTexture>> textures;
+
+public:
+	int maxSize;
+
+	ThumbnailTextureCache() : maxSize(256) {}
+
+	void SetRootFolder(const TCHAR *folder) { rootFolder = folder; }
+
+	// Returns nullptr for textures that can't be found or decoded.
+	const ThumbnailTexture *Get(const std::string &path);
+};
+
+// Rasterizes every mesh of the lowest staged LOD index, tiles are shaded in parallel on taskScheduler.
+// Background is transparent, view is fitted to the model.
+// textures can be null, first texture of submesh material is used as diffuse.
+bool RenderThumbnail(const ModelStaging &staging, const ThumbnailSettings &settings, ThumbnailTextureCache *textures,
+	ThumbnailImage &outImage);
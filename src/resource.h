@@ -23,6 +23,11 @@
 #define IDC_CH_FORCESTDMAT              1003
 #define IDC_CH_FORCESTDMAT2             1004
 #define IDC_CH_ENABLEVIEWMAT            1004
+#define IDC_CH_LOGFILE                  1005
+#define IDC_EDIT_LODS                   1007
+#define IDC_CH_TRACE                    1008
+#define IDC_CH_REIMPORT                 1009
+#define IDC_CH_PROXY                    1010
 #define IDC_COLOR                       1456
 #define IDC_EDIT                        1490
 #define IDC_SPIN                        1496